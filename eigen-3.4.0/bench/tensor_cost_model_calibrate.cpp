@@ -0,0 +1,37 @@
+// g++ -O3 -DNDEBUG -std=c++11 -pthread -I.. -I../unsupported tensor_cost_model_calibrate.cpp -o tensor_cost_model_calibrate && ./tensor_cost_model_calibrate [threads] [profile]
+//
+// Calibrates the TensorCostModel on this host and writes the parameters to a
+// profile, to be loaded later with EIGEN_TENSOR_COST_PROFILE=<profile>.
+
+#define EIGEN_USE_THREADS
+#include <iostream>
+#include <cstdlib>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+using namespace Eigen;
+
+int main(int argc, char** argv)
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+  const char* profile = argc > 2 ? argv[2] : "eigen_cost_profile";
+
+  ThreadPool pool(threads);
+  ThreadPoolDevice device(&pool, threads);
+  const TensorCostModelParameters defaults;
+  const TensorCostModelParameters params = calibrateTensorCostModel(device);
+
+  std::cout << "threads " << threads << "\n"
+            << "  load_cycles       " << params.load_cycles << " (default " << defaults.load_cycles << ")\n"
+            << "  store_cycles      " << params.store_cycles << " (default " << defaults.store_cycles << ")\n"
+            << "  compute_cycles    " << params.compute_cycles << " (default " << defaults.compute_cycles << ")\n"
+            << "  startup_cycles    " << params.startup_cycles << " (default " << defaults.startup_cycles << ")\n"
+            << "  per_thread_cycles " << params.per_thread_cycles << " (default " << defaults.per_thread_cycles << ")\n"
+            << "  task_size         " << params.task_size << " (default " << defaults.task_size << ")\n";
+  if (!params.save(profile))
+  {
+    std::cerr << "cannot write " << profile << "\n";
+    return 1;
+  }
+  std::cout << "wrote " << profile << "\n";
+  return 0;
+}
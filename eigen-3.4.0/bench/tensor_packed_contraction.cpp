@@ -0,0 +1,67 @@
+// g++ -O3 -DNDEBUG -std=c++11 -pthread -I.. -I../unsupported tensor_packed_contraction.cpp -o tensor_packed_contraction && ./tensor_packed_contraction [threads] [in] [out]
+//
+// Measures small batch inference of a dense layer, out = input * weights, as
+// a tensor contraction on the ThreadPoolDevice: with the weights packed at
+// every contraction, and with the weights packed once in a
+// TensorContractionPackedRhs.
+
+#define EIGEN_USE_THREADS
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <unsupported/Eigen/CXX11/Tensor>
+
+using namespace Eigen;
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename Func>
+static double median_micros(Func f, int tries)
+{
+  std::vector<double> times(tries);
+  for (int k = 0; k < tries; ++k)
+  {
+    const Clock::time_point start = Clock::now();
+    f();
+    times[k] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+  std::sort(times.begin(), times.end());
+  return times[tries / 2];
+}
+
+int main(int argc, char** argv)
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+  const Index in = argc > 2 ? std::atol(argv[2]) : 1024;
+  const Index out = argc > 3 ? std::atol(argv[3]) : 1024;
+  const int tries = 50;
+
+  ThreadPool pool(threads);
+  ThreadPoolDevice device(&pool, threads);
+  Tensor<float, 2> weights(in, out);
+  weights.setRandom();
+  array<IndexPair<Index>, 1> dims = {{IndexPair<Index>(1, 0)}};
+
+  std::cout << "threads " << threads << ", weights " << in << "x" << out << "\n";
+  const Index batches[] = {2, 8, 32, 128};
+  for (int b = 0; b < 4; ++b)
+  {
+    const Index batch = batches[b];
+    Tensor<float, 2> input(batch, in), result(batch, out);
+    input.setRandom();
+    TensorContractionPackedRhs<float> packed;
+    result.device(device) = input.contract(weights, dims, NoOpOutputKernel(), &packed);
+
+    const double repacked = median_micros([&]() {
+      result.device(device) = input.contract(weights, dims);
+    }, tries);
+    const double prepacked = median_micros([&]() {
+      result.device(device) = input.contract(weights, dims, NoOpOutputKernel(), &packed);
+    }, tries);
+    std::cout << "  batch " << batch << ": packed every time " << repacked
+              << " us, prepacked " << prepacked << " us\n";
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+// g++ -O3 -DNDEBUG -std=c++11 -pthread -I.. -I../unsupported thread_pool_burst.cpp -o thread_pool_burst && ./thread_pool_burst [threads] [burst] [task_ns]
+//
+// Measures burst submission on the non-blocking ThreadPool: a task running on a
+// worker fans out `burst` small tasks at once, which is more than the 1024 slots
+// of its queue, as TensorExecutor blocks or per-sample tasks do. Reports how
+// long the producer is held in Schedule, and the completion latency of the tasks
+// counted from the start of the burst.
+
+#define EIGEN_USE_THREADS
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <Eigen/CXX11/ThreadPool>
+
+using namespace Eigen;
+
+typedef std::chrono::steady_clock Clock;
+
+static double micros(Clock::time_point a, Clock::time_point b)
+{
+  return std::chrono::duration<double, std::micro>(b - a).count();
+}
+
+static void spin_for(long ns)
+{
+  const Clock::time_point end = Clock::now() + std::chrono::nanoseconds(ns);
+  while (Clock::now() < end) {}
+}
+
+int main(int argc, char** argv)
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+  const int burst = argc > 2 ? std::atoi(argv[2]) : 20000;
+  const long task_ns = argc > 3 ? std::atol(argv[3]) : 1000;
+  const int tries = 10;
+
+  ThreadPool pool(threads);
+  std::vector<double> submit(tries), makespan(tries), latencies;
+  latencies.reserve(size_t(tries) * burst);
+
+  for (int k = 0; k < tries; ++k)
+  {
+    std::vector<Clock::time_point> finished(burst);
+    Barrier done(burst);
+    Clock::time_point start, submitted;
+    Barrier producer(1);
+    pool.Schedule([&]() {
+      start = Clock::now();
+      for (int i = 0; i < burst; ++i)
+        pool.Schedule([&, i]() {
+          spin_for(task_ns);
+          finished[i] = Clock::now();
+          done.Notify();
+        });
+      submitted = Clock::now();
+      producer.Notify();
+    });
+    producer.Wait();
+    done.Wait();
+    submit[k] = micros(start, submitted);
+    makespan[k] = micros(start, *std::max_element(finished.begin(), finished.end()));
+    for (int i = 0; i < burst; ++i)
+      latencies.push_back(micros(start, finished[i]));
+  }
+
+  std::sort(submit.begin(), submit.end());
+  std::sort(makespan.begin(), makespan.end());
+  std::sort(latencies.begin(), latencies.end());
+  const size_t n = latencies.size();
+  std::cout << "threads " << threads << ", burst " << burst << ", task " << task_ns << " ns\n";
+  std::cout << "  producer blocked in Schedule (median): " << submit[tries / 2] << " us\n";
+  std::cout << "  burst makespan (median):               " << makespan[tries / 2] << " us\n";
+  std::cout << "  task completion latency p50/p99/max:   " << latencies[n / 2] << " / "
+            << latencies[n * 99 / 100] << " / " << latencies[n - 1] << " us\n";
+  return 0;
+}
@@ -615,6 +615,15 @@ class TensorBase<Derived, ReadOnlyAccessors>
       return TensorContractionOp<const Dimensions, const Derived, const OtherDerived, const OutputKernel>(derived(), other.derived(), dims, output_kernel);
     }
 
+    // Contraction that keeps other packed in packed_rhs across calls, see
+    // TensorContractionPackedRhs.
+    template<typename OtherDerived, typename Dimensions, typename OutputKernel> EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE
+    const TensorContractionOp<const Dimensions, const Derived, const OtherDerived, const OutputKernel>
+    contract(const OtherDerived& other, const Dimensions& dims, const OutputKernel& output_kernel,
+             typename TensorContractionOp<const Dimensions, const Derived, const OtherDerived, const OutputKernel>::PackedRhs* packed_rhs) const {
+      return TensorContractionOp<const Dimensions, const Derived, const OtherDerived, const OutputKernel>(derived(), other.derived(), dims, output_kernel, packed_rhs);
+    }
+
     // Convolutions.
     template<typename KernelDerived, typename Dimensions> EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE
     const TensorConvolutionOp<const Dimensions, const Derived, const KernelDerived>
@@ -276,6 +276,112 @@ struct TensorContractionKernel {
 
 }  // end namespace internal
 
+// TensorContractionPackedRhs holds the right argument of a contraction already
+// packed into the panels consumed by TensorContractionKernel, for a given
+// blocking. Contractions that receive it skip the packing of their right
+// argument, which pays off when the same operand is contracted many times, e.g.
+// the weights of a layer during inference:
+//
+//   TensorContractionPackedRhs<float> packed_weights;
+//   for (...) {
+//     out.device(d) = input.contract(weights, dims, NoOpOutputKernel(),
+//                                    &packed_weights);
+//   }
+//
+// The panels are filled by the first contraction that receives an empty
+// object, which also fixes the blocking. Following contractions reuse them as
+// long as they contract the same tensor, i.e. the same data with the same
+// dimensions and strides, and pack it again otherwise. Arguments that are not
+// backed by memory, e.g. weights * 2, are packed by every contraction. Changes
+// to the data of the tensor itself are not detected: call clear() after them.
+// Filling is not synchronized: do not hand an object to several contractions
+// running concurrently unless it already holds their right argument.
+//
+// The evaluators swap the arguments in RowMajor layout, so the panels are
+// those of their right hand side in ColMajor layout and of their left hand
+// side in RowMajor layout. Either way rows() is the contracted size and cols()
+// the size of the other dimensions of the right argument.
+template <typename Scalar, typename Index>
+class TensorContractionPackedRhs {
+ public:
+  TensorContractionPackedRhs()
+      : m_data(NULL), m_source(NULL), m_k(0), m_n(0), m_bk(0), m_bn(0),
+        m_nk(0), m_block_bytes(0) {}
+
+  ~TensorContractionPackedRhs() { internal::aligned_free(m_data); }
+
+  bool empty() const { return m_data == NULL; }
+
+  // Drops the panels: the next contraction packs its right argument again.
+  void clear() {
+    internal::aligned_free(m_data);
+    m_data = NULL;
+    m_source = NULL;
+    m_strides.clear();
+    m_k = m_n = m_bk = m_bn = m_nk = m_block_bytes = 0;
+  }
+
+  // Sizes of the packed matrix, and of the blocks it is split into.
+  Index rows() const { return m_k; }
+  Index cols() const { return m_n; }
+  Index blockRows() const { return m_bk; }
+  Index blockCols() const { return m_bn; }
+
+  // Internal interface for the contraction evaluators.
+
+  // Returns true if the panels hold the k x n matrix read from source with the
+  // given strides. A NULL source never matches.
+  bool matches(Index k, Index n, const void* source,
+               const std::vector<Index>& strides) const {
+    return m_data != NULL && source != NULL && m_source == source &&
+           m_k == k && m_n == n && m_strides == strides;
+  }
+
+  // Allocates the panels for the k x n matrix read from source with the given
+  // strides, split into bk x bn blocks. Their content is undefined until
+  // packed.
+  void resize(Index k, Index n, Index bk, Index bn, const void* source,
+              const std::vector<Index>& strides) {
+    eigen_assert(k > 0 && n > 0 && bk > 0 && bn > 0);
+    const Index align = numext::maxi<Index>(EIGEN_MAX_ALIGN_BYTES, 1);
+    const Index block_bytes =
+        divup<Index>(bk * bn * sizeof(Scalar), align) * align;
+    const Index nk = divup(k, bk);
+    const Index nn = divup(n, bn);
+    internal::aligned_free(m_data);
+    m_data = static_cast<char*>(internal::aligned_malloc(nk * nn * block_bytes));
+    m_source = source;
+    m_strides = strides;
+    m_k = k;
+    m_n = n;
+    m_bk = bk;
+    m_bn = bn;
+    m_nk = nk;
+    m_block_bytes = block_bytes;
+  }
+
+  // Returns the panel of the block at the given block coordinates. The blocks
+  // of a block column are contiguous.
+  void* block(Index k_block, Index n_block) const {
+    eigen_assert(m_data != NULL && k_block < m_nk);
+    return m_data + (n_block * m_nk + k_block) * m_block_bytes;
+  }
+
+ private:
+  char* m_data;
+  const void* m_source;
+  std::vector<Index> m_strides;
+  Index m_k;
+  Index m_n;
+  Index m_bk;
+  Index m_bn;
+  Index m_nk;
+  Index m_block_bytes;
+
+  TensorContractionPackedRhs(const TensorContractionPackedRhs&);
+  void operator=(const TensorContractionPackedRhs&);
+};
+
 // Tensor contraction params that should enable to get from output matrix
 // 2-dimensional coordinates to the output tensor dimensions.
 struct TensorContractionParams {
@@ -332,11 +438,16 @@ class TensorContractionOp : public TensorBase<TensorContractionOp<Indices, LhsXp
   typedef typename Eigen::internal::traits<TensorContractionOp>::StorageKind StorageKind;
   typedef typename Eigen::internal::traits<TensorContractionOp>::Index Index;
 
+  typedef TensorContractionPackedRhs<
+      typename internal::remove_const<typename RhsXprType::Scalar>::type, Index>
+      PackedRhs;
+
   EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE TensorContractionOp(
       const LhsXprType& lhs, const RhsXprType& rhs, const Indices& dims,
-      const OutputKernelType& output_kernel = OutputKernelType())
+      const OutputKernelType& output_kernel = OutputKernelType(),
+      PackedRhs* packed_rhs = NULL)
       : m_lhs_xpr(lhs), m_rhs_xpr(rhs), m_indices(dims),
-        m_output_kernel(output_kernel) {}
+        m_output_kernel(output_kernel), m_packed_rhs(packed_rhs) {}
 
   EIGEN_DEVICE_FUNC
   const Indices& indices() const { return m_indices; }
@@ -353,11 +464,15 @@ class TensorContractionOp : public TensorBase<TensorContractionOp<Indices, LhsXp
   EIGEN_DEVICE_FUNC
   const OutputKernelType& outputKernel() const { return m_output_kernel; }
 
+  EIGEN_DEVICE_FUNC
+  PackedRhs* packedRhs() const { return m_packed_rhs; }
+
   protected:
     typename LhsXprType::Nested m_lhs_xpr;
     typename RhsXprType::Nested m_rhs_xpr;
     const Indices m_indices;
     const OutputKernelType m_output_kernel;
+    PackedRhs* const m_packed_rhs;
 };
 
 
@@ -377,6 +492,7 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
   typedef typename PacketType<CoeffReturnType, Device>::type PacketReturnType;
   typedef StorageMemory<Scalar, Device> Storage;
   typedef typename Storage::Type EvaluatorPointerType;
+  typedef typename XprType::PackedRhs PackedRhs;
 
   enum {
     IsAligned         = true,
@@ -417,6 +533,12 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
 
   typedef DSizes<Index, NumDims> Dimensions;
 
+  // The right argument of contract(), held by m_packed_rhs, is the right hand
+  // side of the evaluator in ColMajor layout, and its left hand side in
+  // RowMajor layout.
+  static const bool PrepackedLhs =
+      static_cast<int>(Layout) == static_cast<int>(RowMajor);
+
   EIGEN_STRONG_INLINE
   TensorContractionEvaluatorBase(const XprType& op, const Device& device)
       : m_leftImpl(choose(Cond<static_cast<int>(Layout) == static_cast<int>(ColMajor)>(),
@@ -425,6 +547,7 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
                            op.rhsExpression(), op.lhsExpression()), device),
         m_device(device),
         m_output_kernel(op.outputKernel()),
+        m_packed_rhs(op.packedRhs()),
         m_result(NULL) {
     EIGEN_STATIC_ASSERT((static_cast<int>(TensorEvaluator<LeftArgType, Device>::Layout) ==
          static_cast<int>(TensorEvaluator<RightArgType, Device>::Layout)),
@@ -712,6 +835,19 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
   }
 #endif  // EIGEN_USE_THREADS
 
+  // Returns true if m_packed_rhs holds the right argument of this contraction,
+  // whose non contracted dimensions have cols coefficients.
+  bool packedRhsMatches(Index k, Index cols) const {
+    return m_packed_rhs->matches(k, cols, packedRhsSource(), packedRhsStrides());
+  }
+
+  // Allocates m_packed_rhs for the right argument of this contraction, split
+  // into bk x bcols blocks.
+  void resizePackedRhs(Index k, Index cols, Index bk, Index bcols) const {
+    m_packed_rhs->resize(k, cols, bk, bcols, packedRhsSource(),
+                         packedRhsStrides());
+  }
+
   template <bool lhs_inner_dim_contiguous, bool rhs_inner_dim_contiguous,
             bool rhs_inner_dim_reordered, int Alignment>
   void evalProductSequential(Scalar* buffer) const {
@@ -850,9 +986,26 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
     internal::TensorContractionBlocking<Scalar, LhsScalar, RhsScalar,
                                         Index, internal::ShardByCol>
         blocking(k_slice, m, n, num_threads);
-    const Index kc = blocking.kc();
-    const Index mc = numext::mini(m, blocking.mc());
-    const Index nc = numext::mini(n, blocking.nc());
+    Index kc = blocking.kc();
+    Index mc = numext::mini(m, blocking.mc());
+    Index nc = numext::mini(n, blocking.nc());
+
+    // A prepacked right argument imposes its blocking. If it does not hold
+    // this one yet, it is packed in place the first time each of its blocks
+    // is needed, and reused after.
+    PackedRhs* packed_rhs =
+        k_slice == this->m_k_size ? this->m_packed_rhs : NULL;
+    bool pack_rhs = true;
+    if (packed_rhs != NULL) {
+      if (this->packedRhsMatches(k_slice, PrepackedLhs ? m : n)) {
+        kc = packed_rhs->blockRows();
+        (PrepackedLhs ? mc : nc) = packed_rhs->blockCols();
+        pack_rhs = false;
+      } else {
+        this->resizePackedRhs(k_slice, PrepackedLhs ? m : n, kc,
+                              PrepackedLhs ? mc : nc);
+      }
+    }
 
     typedef typename TensorContractionKernel::LhsBlock LhsBlock;
     typedef typename TensorContractionKernel::RhsBlock RhsBlock;
@@ -878,7 +1031,16 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
       for (Index k2 = k_start; k2 < k_end; k2 += kc) {
         // make sure we don't overshoot right edge of left matrix, then pack vertical panel
         const Index actual_kc = numext::mini(k2 + kc, k_end) - k2;
-        kernel.packLhs(&blockA, lhs.getSubMapper(i2, k2), actual_kc, actual_mc);
+        if (PrepackedLhs && packed_rhs != NULL) {
+          blockA = static_cast<LhsBlock>(packed_rhs->block(k2 / kc, i2 / mc));
+          if (pack_rhs) {
+            kernel.packLhs(&blockA, lhs.getSubMapper(i2, k2), actual_kc,
+                           actual_mc);
+          }
+        } else {
+          kernel.packLhs(&blockA, lhs.getSubMapper(i2, k2), actual_kc,
+                         actual_mc);
+        }
 
         // If kernel supports beta, there is no need to initialize output
         // buffer with zeroes.
@@ -891,8 +1053,16 @@ struct TensorContractionEvaluatorBase : internal::no_assignment_operator
         for (Index j2 = 0; j2 < n; j2 += nc) {
           // make sure we don't overshoot right edge of right matrix, then pack block
           const Index actual_nc = numext::mini(j2 + nc, n) - j2;
-          kernel.packRhs(&blockB, rhs.getSubMapper(k2, j2), actual_kc,
-                         actual_nc);
+          if (!PrepackedLhs && packed_rhs != NULL) {
+            blockB = static_cast<RhsBlock>(packed_rhs->block(k2 / kc, j2 / nc));
+            if (pack_rhs && i2 == 0) {
+              kernel.packRhs(&blockB, rhs.getSubMapper(k2, j2), actual_kc,
+                             actual_nc);
+            }
+          } else {
+            kernel.packRhs(&blockB, rhs.getSubMapper(k2, j2), actual_kc,
+                           actual_nc);
+          }
 
           // call gebp (matrix kernel)
           // The parameters here are copied from Eigen's GEMM implementation
@@ -963,7 +1133,44 @@ protected:
   TensorEvaluator<EvalRightArgType, Device> m_rightImpl;
   const Device EIGEN_DEVICE_REF m_device;
   OutputKernelType m_output_kernel;
+  PackedRhs* m_packed_rhs;
   EvaluatorPointerType m_result;
+
+ private:
+  // Identify the right argument of contract(): its data, if it has any, and
+  // how the evaluator reads it.
+  const void* packedRhsSource() const {
+    return PrepackedLhs ? static_cast<const void*>(m_leftImpl.data())
+                        : static_cast<const void*>(m_rightImpl.data());
+  }
+
+  std::vector<Index> packedRhsStrides() const {
+    std::vector<Index> strides;
+    if (PrepackedLhs) {
+      strides.push_back(m_lhs_inner_dim_contiguous);
+      for (int i = 0; i < LDims - ContractDims; i++) {
+        strides.push_back(m_left_nocontract_strides[i]);
+        strides.push_back(m_i_strides[i]);
+      }
+      for (int i = 0; i < ContractDims; i++) {
+        strides.push_back(m_left_contracting_strides[i]);
+      }
+    } else {
+      strides.push_back(m_rhs_inner_dim_contiguous);
+      strides.push_back(m_rhs_inner_dim_reordered);
+      for (int i = 0; i < RDims - ContractDims; i++) {
+        strides.push_back(m_right_nocontract_strides[i]);
+        strides.push_back(m_j_strides[i]);
+      }
+      for (int i = 0; i < ContractDims; i++) {
+        strides.push_back(m_right_contracting_strides[i]);
+      }
+    }
+    for (int i = 0; i < ContractDims; i++) {
+      strides.push_back(m_k_strides[i]);
+    }
+    return strides;
+  }
 };
 
 
@@ -159,7 +159,10 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
     int num_threads = TensorCostModel<ThreadPoolDevice>::numThreads(
         static_cast<double>(n) * m, cost, this->m_device.numThreads());
     int num_threads_by_k = numThreadsInnerDim(m, n, k);
-    if (shardByInnerDim(m, n, k, num_threads, num_threads_by_k)) {
+    // Sharding by the inner dimension splits k at arbitrary points, that do
+    // not line up with the blocks of a prepacked right argument.
+    if (this->m_packed_rhs == NULL &&
+        shardByInnerDim(m, n, k, num_threads, num_threads_by_k)) {
       // We are in the scenario where it is more effective to shard by the
       // inner dimension.
       if (IsEvalInSyncMode) {
@@ -204,6 +207,14 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
       bk = blocking.kc();
     }
 
+    // A prepacked right argument imposes its blocking, otherwise it is packed
+    // with the blocking chosen here.
+    if (this->m_packed_rhs != NULL &&
+        this->packedRhsMatches(k, Self::PrepackedLhs ? m : n)) {
+      bk = this->m_packed_rhs->blockRows();
+      (Self::PrepackedLhs ? bm : bn) = this->m_packed_rhs->blockCols();
+    }
+
     // Number of kernels for each dimension.
     Index nm0 = divup(m, bm);
     Index nn0 = divup(n, bn);
@@ -371,6 +382,7 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
     typedef typename TensorContractionKernel::LhsBlock LhsBlock;
     typedef typename TensorContractionKernel::RhsBlock RhsBlock;
     typedef typename TensorContractionKernel::BlockMemHandle BlockMemHandle;
+    typedef typename Self::PackedRhs PackedRhs;
 
     EvalParallelContext(const Self* self, int num_threads, Scalar* buffer,
                         Index tm, Index tn, Index tk, Index bm, Index bn,
@@ -410,6 +422,10 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
           nm0_(nm0),
           nn0_(nn0),
           kernel_(m_, k_, n_, bm_, bk_, bn_),
+          prepacked_(self->m_packed_rhs),
+          reuse_prepacked_(prepacked_ != NULL &&
+                           self->packedRhsMatches(
+                               tk, Self::PrepackedLhs ? tm : tn)),
           num_thread_local_allocations_(0),
           // We reserve 2X more capacity for a thread local values, than the
           // number of threads in the pool to efficiently handle task stealing
@@ -451,12 +467,42 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
         }
       }
 
+      // A prepacked right argument replaces the packed slices of its side. If
+      // it does not hold this argument yet, the packing tasks of that side
+      // fill it.
+      if (prepacked_ != NULL) {
+        const Index cols = Self::PrepackedLhs ? m_ : n_;
+        const Index bcols = Self::PrepackedLhs ? bm_ : bn_;
+        const Index ncols = Self::PrepackedLhs ? nm0_ : nn0_;
+        if (reuse_prepacked_) {
+          eigen_assert(prepacked_->blockRows() == bk_ &&
+                       prepacked_->blockCols() == bcols);
+        } else {
+          self->resizePackedRhs(k_, cols, bk_, bcols);
+        }
+        if (Self::PrepackedLhs) {
+          prepacked_lhs_.resize(nk_ * nm0_);
+        } else {
+          prepacked_rhs_.resize(nk_ * nn0_);
+        }
+        for (Index k = 0; k < nk_; k++)
+          for (Index c = 0; c < ncols; c++) {
+            if (Self::PrepackedLhs) {
+              prepacked_lhs_[k * nm0_ + c] =
+                  static_cast<LhsBlock>(prepacked_->block(k, c));
+            } else {
+              prepacked_rhs_[k * nn0_ + c] =
+                  static_cast<RhsBlock>(prepacked_->block(k, c));
+            }
+          }
+      }
+
       // Allocate memory for packed rhs/lhs matrices.
-      packed_mem_ = kernel_.allocateSlices(            //
-          device_,                                     //
-          /*num_lhs=*/nm0_,                            //
-          /*num_rhs=*/nn0_,                            //
-          /*num_slices=*/std::min<Index>(nk_, P - 1),  //
+      packed_mem_ = kernel_.allocateSlices(                   //
+          device_,                                            //
+          /*num_lhs=*/prepacked_lhs_.empty() ? nm0_ : 0,      //
+          /*num_rhs=*/prepacked_rhs_.empty() ? nn0_ : 0,      //
+          /*num_slices=*/std::min<Index>(nk_, P - 1),         //
           packed_lhs_, packed_rhs_);
 
       if (parallelize_by_sharding_dim_only_) {
@@ -565,6 +611,15 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
     // Tensor contraction kernel.
     TensorContractionKernel kernel_;
 
+    // Persistent panels of the right argument of contract(), reused as is or
+    // filled by this contraction, and the pointers to each of their blocks:
+    // nk_ x nm0_ lhs blocks in RowMajor layout, nk_ x nn0_ rhs blocks
+    // otherwise. The other vector is empty.
+    PackedRhs* const prepacked_;
+    const bool reuse_prepacked_;
+    std::vector<LhsBlock> prepacked_lhs_;
+    std::vector<RhsBlock> prepacked_rhs_;
+
     // Parallelization strategy.
     //
     // Blocks related to the same k block can run in parallel because they write
@@ -818,7 +873,9 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
     std::atomic<Index> state_switch_[P];
 
     LhsBlock& packed_lhs(Index m, Index k, Index m1, bool use_thread_local) {
-      if (use_thread_local) {
+      if (!prepacked_lhs_.empty()) {
+        return prepacked_lhs_[k * nm0_ + m1];
+      } else if (use_thread_local) {
         eigen_assert(!shard_by_col_);
         ThreadLocalBlocks<LhsBlock>& blocks = lhs_thread_local_blocks_.local();
 
@@ -830,7 +887,9 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
     }
 
     RhsBlock& packed_rhs(Index n, Index k, Index n1, bool use_thread_local) {
-      if (use_thread_local) {
+      if (!prepacked_rhs_.empty()) {
+        return prepacked_rhs_[k * nn0_ + n1];
+      } else if (use_thread_local) {
         eigen_assert(shard_by_col_);
         ThreadLocalBlocks<RhsBlock>& blocks = rhs_thread_local_blocks_.local();
 
@@ -855,6 +914,7 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
       bool use_thread_local = false;
 
       if (parallelize_by_sharding_dim_only_ && !shard_by_col_ &&
+          prepacked_lhs_.empty() &&
           can_use_thread_local_packed_[m].load(std::memory_order_relaxed)) {
         if (state_kernel_[k % P][m][0].load(std::memory_order_relaxed) == 1) {
           use_thread_local = true;
@@ -869,9 +929,11 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
       }
 
       const Index mend = m * gm_ + gm(m);
-      for (Index m1 = m * gm_; m1 < mend; m1++)
-        kernel_.packLhs(&packed_lhs(m, k, m1, use_thread_local),
-                        lhs_.getSubMapper(m1 * bm_, k * bk_), bk(k), bm(m1));
+      if (prepacked_lhs_.empty() || !reuse_prepacked_) {
+        for (Index m1 = m * gm_; m1 < mend; m1++)
+          kernel_.packLhs(&packed_lhs(m, k, m1, use_thread_local),
+                          lhs_.getSubMapper(m1 * bm_, k * bk_), bk(k), bm(m1));
+      }
 
       if (!parallel_pack_ && shard_by_col_) {
         assert(!use_thread_local);
@@ -889,6 +951,7 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
       bool use_thread_local = false;
 
       if (parallelize_by_sharding_dim_only_ && shard_by_col_ &&
+          prepacked_rhs_.empty() &&
           can_use_thread_local_packed_[n].load(std::memory_order_relaxed)) {
         if (state_kernel_[k % P][0][n].load(std::memory_order_relaxed) == 1) {
           use_thread_local = true;
@@ -916,8 +979,10 @@ struct TensorEvaluator<const TensorContractionOp<Indices, LeftArgType, RightArgT
           // worker thread, which can lead to underutilization and deadlocks.
           memset(buffer_ + n1 * bn_ * m_, 0, bn(n1) * m_ * sizeof(Scalar));
         }
-        kernel_.packRhs(&packed_rhs(n, k, n1, use_thread_local),
-                        rhs_.getSubMapper(k * bk_, n1 * bn_), bk(k), bn(n1));
+        if (prepacked_rhs_.empty() || !reuse_prepacked_) {
+          kernel_.packRhs(&packed_rhs(n, k, n1, use_thread_local),
+                          rhs_.getSubMapper(k * bk_, n1 * bn_), bk(k), bn(n1));
+        }
       }
 
       if (parallel_pack_ || shard_by_col_) {
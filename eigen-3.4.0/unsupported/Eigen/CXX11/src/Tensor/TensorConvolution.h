@@ -559,6 +559,334 @@ struct TensorEvaluator<const TensorConvolutionOp<Indices, InputArgType, KernelAr
 
 
 
+#ifdef EIGEN_USE_THREADS
+// Multi-threaded evaluation on the ThreadPoolDevice: the output is split into
+// blocks with the TensorBlockMapper, the block size is picked by the
+// TensorCostModel (same as in the tiled TensorExecutor), and the blocks are
+// evaluated in parallel. Inside a block every row along the innermost output
+// dimension reads a contiguous range of the input, so it is vectorized one
+// packet of outputs at a time.
+template<typename Indices, typename InputArgType, typename KernelArgType>
+struct TensorEvaluator<const TensorConvolutionOp<Indices, InputArgType, KernelArgType>, ThreadPoolDevice>
+{
+  typedef TensorConvolutionOp<Indices, InputArgType, KernelArgType> XprType;
+
+  static const int NumDims = internal::array_size<typename TensorEvaluator<InputArgType, ThreadPoolDevice>::Dimensions>::value;
+  static const int NumKernelDims = internal::array_size<Indices>::value;
+  typedef typename XprType::Index Index;
+  typedef DSizes<Index, NumDims> Dimensions;
+
+  typedef typename XprType::Scalar Scalar;
+  typedef typename XprType::CoeffReturnType CoeffReturnType;
+  typedef typename PacketType<CoeffReturnType, ThreadPoolDevice>::type PacketReturnType;
+  static const int PacketSize = PacketType<CoeffReturnType, ThreadPoolDevice>::size;
+  typedef StorageMemory<Scalar, ThreadPoolDevice> Storage;
+  typedef typename Storage::Type EvaluatorPointerType;
+
+  enum {
+    IsAligned = true,
+    PacketAccess = (PacketSize > 1),
+    BlockAccess = false,
+    PreferBlockAccess = false,
+    Layout = TensorEvaluator<InputArgType, ThreadPoolDevice>::Layout,
+    CoordAccess = false,  // to be implemented
+    RawAccess = false
+  };
+
+  //===- Tensor block evaluation strategy (see TensorBlock.h) -------------===//
+  typedef internal::TensorBlockNotImplemented TensorBlock;
+  //===--------------------------------------------------------------------===//
+
+  typedef internal::TensorBlockMapper<NumDims, Layout, Index> BlockMapper;
+  typedef internal::TensorBlockDescriptor<NumDims, Index> BlockDesc;
+
+  EIGEN_STRONG_INLINE TensorEvaluator(const XprType& op, const ThreadPoolDevice& device)
+      : m_inputImpl(op.inputExpression(), device), m_kernelImpl(op.kernelExpression(), device), m_kernelArg(op.kernelExpression()), m_buf(NULL), m_kernel(NULL), m_local_kernel(false), m_device(device)
+  {
+    EIGEN_STATIC_ASSERT((static_cast<int>(TensorEvaluator<InputArgType, ThreadPoolDevice>::Layout) == static_cast<int>(TensorEvaluator<KernelArgType, ThreadPoolDevice>::Layout)), YOU_MADE_A_PROGRAMMING_MISTAKE);
+
+    const typename TensorEvaluator<InputArgType, ThreadPoolDevice>::Dimensions& input_dims = m_inputImpl.dimensions();
+    const typename TensorEvaluator<KernelArgType, ThreadPoolDevice>::Dimensions& kernel_dims = m_kernelImpl.dimensions();
+
+    if (static_cast<int>(Layout) == static_cast<int>(ColMajor)) {
+      m_inputStride[0] = 1;
+      for (int i = 1; i < NumDims; ++i) {
+        m_inputStride[i] = m_inputStride[i - 1] * input_dims[i - 1];
+      }
+    } else {
+      m_inputStride[NumDims - 1] = 1;
+      for (int i = NumDims - 2; i >= 0; --i) {
+        m_inputStride[i] = m_inputStride[i + 1] * input_dims[i + 1];
+      }
+    }
+
+    m_dimensions = m_inputImpl.dimensions();
+    if (static_cast<int>(Layout) == static_cast<int>(ColMajor)) {
+      for (int i = 0; i < NumKernelDims; ++i) {
+        const Index index = op.indices()[i];
+        const Index input_dim = input_dims[index];
+        const Index kernel_dim = kernel_dims[i];
+        const Index result_dim = input_dim - kernel_dim + 1;
+        m_dimensions[index] = result_dim;
+        if (i > 0) {
+          m_kernelStride[i] = m_kernelStride[i - 1] * kernel_dims[i - 1];
+        } else {
+          m_kernelStride[0] = 1;
+        }
+        m_indexStride[i] = m_inputStride[index];
+      }
+
+      m_outputStride[0] = 1;
+      for (int i = 1; i < NumDims; ++i) {
+        m_outputStride[i] = m_outputStride[i - 1] * m_dimensions[i - 1];
+      }
+    } else {
+      for (int i = NumKernelDims - 1; i >= 0; --i) {
+        const Index index = op.indices()[i];
+        const Index input_dim = input_dims[index];
+        const Index kernel_dim = kernel_dims[i];
+        const Index result_dim = input_dim - kernel_dim + 1;
+        m_dimensions[index] = result_dim;
+        if (i < NumKernelDims - 1) {
+          m_kernelStride[i] = m_kernelStride[i + 1] * kernel_dims[i + 1];
+        } else {
+          m_kernelStride[NumKernelDims - 1] = 1;
+        }
+        m_indexStride[i] = m_inputStride[index];
+      }
+
+      m_outputStride[NumDims - 1] = 1;
+      for (int i = NumDims - 2; i >= 0; --i) {
+        m_outputStride[i] = m_outputStride[i + 1] * m_dimensions[i + 1];
+      }
+    }
+  }
+
+  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE const Dimensions& dimensions() const { return m_dimensions; }
+
+  EIGEN_STRONG_INLINE bool evalSubExprsIfNeeded(EvaluatorPointerType data) {
+    m_inputImpl.evalSubExprsIfNeeded(NULL);
+    preloadKernel();
+    if (data) {
+      executeEval(data);
+      return false;
+    } else {
+      m_buf = static_cast<EvaluatorPointerType>(
+          m_device.allocate(dimensions().TotalSize() * sizeof(Scalar)));
+      executeEval(m_buf);
+      return true;
+    }
+  }
+
+  EIGEN_STRONG_INLINE void cleanup() {
+    m_inputImpl.cleanup();
+    if (m_buf) {
+      m_device.deallocate(m_buf);
+      m_buf = NULL;
+    }
+    if (m_local_kernel) {
+      m_device.deallocate((void*)m_kernel);
+      m_local_kernel = false;
+    }
+    m_kernel = NULL;
+  }
+
+  void executeEval(EvaluatorPointerType data) const {
+    // Pick the block size the same way the tiled TensorExecutor does, so that
+    // a single block is worth scheduling as a task.
+    internal::TensorBlockResourceRequirements requirements =
+        internal::TensorBlockResourceRequirements::skewed<Scalar>(
+            m_device.firstLevelCacheSize());
+    requirements.cost_per_coeff = costPerCoeff(Vectorizable);
+    const double task_size = TensorCostModel<ThreadPoolDevice>::taskSize(
+        1, requirements.cost_per_coeff);
+    requirements.size = static_cast<size_t>(1.0 / task_size);
+
+    if (m_dimensions.TotalSize() == 0) return;
+    const BlockMapper block_mapper(m_dimensions, requirements);
+    const TensorOpCost block_cost =
+        requirements.cost_per_coeff * static_cast<double>(block_mapper.blockTotalSize());
+
+    m_device.parallelFor(
+        block_mapper.blockCount(), block_cost,
+        [this, data, &block_mapper](Index first, Index last) {
+          for (Index i = first; i < last; ++i) {
+            evalBlock(block_mapper.blockDescriptor(i), data);
+          }
+        });
+  }
+
+  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE CoeffReturnType coeff(Index index) const
+  {
+    eigen_assert(m_buf);
+    eigen_assert(index < m_dimensions.TotalSize());
+    return m_buf[index];
+  }
+
+  template<int LoadMode>
+  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE PacketReturnType packet(const Index index) const
+  {
+    eigen_assert(m_buf);
+    eigen_assert(index < m_dimensions.TotalSize());
+    return internal::ploadt<PacketReturnType, LoadMode>(m_buf+index);
+  }
+
+  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE TensorOpCost
+  costPerCoeff(bool vectorized) const {
+    // Inside a block the input offset is computed once per row, so the index
+    // arithmetic of the default evaluator is not part of the per-coeff cost.
+    const double kernel_size = m_kernelImpl.dimensions().TotalSize();
+    // We ignore the use of fused multiply-add.
+    const double convolve_compute_cost =
+        TensorOpCost::AddCost<Scalar>() + TensorOpCost::MulCost<Scalar>();
+    return TensorOpCost(0, sizeof(Scalar), 0, vectorized, PacketSize) +
+           kernel_size * (m_inputImpl.costPerCoeff(vectorized) +
+                          TensorOpCost(sizeof(Scalar), 0, convolve_compute_cost,
+                                       vectorized, PacketSize));
+  }
+
+  EIGEN_DEVICE_FUNC EvaluatorPointerType data() const { return m_buf; }
+
+ private:
+  // The inner loop is vectorized only if the input can be read as packets.
+  static const bool Vectorizable =
+      TensorEvaluator<InputArgType, ThreadPoolDevice>::PacketAccess && (PacketSize > 1);
+
+  void evalBlock(const BlockDesc& desc, Scalar* data) const {
+    const int inner_dim = static_cast<int>(Layout) == static_cast<int>(ColMajor) ? 0 : NumDims - 1;
+    const Index row_size = desc.dimensions()[inner_dim];
+    const Index num_rows = desc.dimensions().TotalSize() / row_size;
+
+    // Coordinates of the current row inside the block (the inner dimension
+    // coordinate always stays at 0).
+    array<Index, NumDims> it;
+    for (int i = 0; i < NumDims; ++i) it[i] = 0;
+
+    Index output_offset = desc.offset();
+    for (Index row = 0; row < num_rows; ++row) {
+      evalRow(firstInput(output_offset), row_size, data + output_offset,
+              internal::bool_constant<Vectorizable>());
+
+      // Move to the next row: increment the block coordinates starting from
+      // the dimension next to the inner one.
+      for (int j = 1; j < NumDims; ++j) {
+        const int dim = static_cast<int>(Layout) == static_cast<int>(ColMajor) ? j : NumDims - 1 - j;
+        if (++it[dim] < desc.dimensions()[dim]) {
+          output_offset += m_outputStride[dim];
+          break;
+        }
+        output_offset -= (it[dim] - 1) * m_outputStride[dim];
+        it[dim] = 0;
+      }
+    }
+  }
+
+  EIGEN_STRONG_INLINE void evalRow(Index input_offset, Index size, Scalar* out,
+                                   internal::true_type) const {
+    const Index vectorized_size = (size / PacketSize) * PacketSize;
+    Index i = 0;
+    for (; i < vectorized_size; i += PacketSize) {
+      PacketReturnType accum = internal::pset1<PacketReturnType>(Scalar(0));
+      convolvePacket(input_offset + i, 0, NumKernelDims-1, accum);
+      internal::pstoreu<Scalar>(out + i, accum);
+    }
+    for (; i < size; ++i) {
+      CoeffReturnType accum = CoeffReturnType(0);
+      convolve(input_offset + i, 0, NumKernelDims-1, accum);
+      out[i] = accum;
+    }
+  }
+
+  EIGEN_STRONG_INLINE void evalRow(Index input_offset, Index size, Scalar* out,
+                                   internal::false_type) const {
+    for (Index i = 0; i < size; ++i) {
+      CoeffReturnType accum = CoeffReturnType(0);
+      convolve(input_offset + i, 0, NumKernelDims-1, accum);
+      out[i] = accum;
+    }
+  }
+
+  EIGEN_STRONG_INLINE Index firstInput(Index index) const {
+    Index startInput = 0;
+    if (static_cast<int>(Layout) == static_cast<int>(ColMajor)) {
+      for (int i = NumDims - 1; i > 0; --i) {
+        const Index idx = index / m_outputStride[i];
+        startInput += idx * m_inputStride[i];
+        index -= idx * m_outputStride[i];
+      }
+    } else {
+      for (int i = 0; i < NumDims - 1; ++i) {
+        const Index idx = index / m_outputStride[i];
+        startInput += idx * m_inputStride[i];
+        index -= idx * m_outputStride[i];
+      }
+    }
+    startInput += index;
+    return startInput;
+  }
+
+  void convolve(Index firstIndex, Index firstKernel, int DimIndex, CoeffReturnType& accum) const {
+    for (int j = 0; j < m_kernelImpl.dimensions()[DimIndex]; ++j) {
+      const Index input = firstIndex + j * m_indexStride[DimIndex];
+      const Index kernel = firstKernel + j * m_kernelStride[DimIndex];
+      if (DimIndex > 0) {
+        convolve(input, kernel, DimIndex-1, accum);
+      } else {
+        accum += m_inputImpl.coeff(input) * m_kernel[kernel];
+      }
+    }
+  }
+
+  template <typename Packet>
+  void convolvePacket(Index firstIndex, Index firstKernel, int DimIndex, Packet& accum) const {
+    for (int j = 0; j < m_kernelImpl.dimensions()[DimIndex]; ++j) {
+      const Index input = firstIndex + j * m_indexStride[DimIndex];
+      const Index kernel = firstKernel + j * m_kernelStride[DimIndex];
+      if (DimIndex > 0) {
+        convolvePacket(input, kernel, DimIndex-1, accum);
+      } else {
+        accum = internal::pmadd<Packet>(m_inputImpl.template packet<Unaligned>(input), internal::pset1<Packet>(m_kernel[kernel]), accum);
+      }
+    }
+  }
+
+  EIGEN_STRONG_INLINE void preloadKernel() {
+    // Don't make a local copy of the kernel unless we have to (i.e. it's an
+    // expression that needs to be evaluated)
+    const Scalar* in_place = m_kernelImpl.data();
+    if (in_place) {
+      m_kernel = in_place;
+      m_local_kernel = false;
+    } else {
+      size_t kernel_sz = m_kernelImpl.dimensions().TotalSize() * sizeof(Scalar);
+      Scalar* local = (Scalar*)m_device.allocate_temp(kernel_sz);
+      typedef TensorEvalToOp<const KernelArgType> EvalTo;
+      EvalTo evalToTmp(local, m_kernelArg);
+      const bool Vectorize = internal::IsVectorizable<ThreadPoolDevice, KernelArgType>::value;
+      internal::TensorExecutor<const EvalTo, ThreadPoolDevice, Vectorize>::run(evalToTmp, m_device);
+
+      m_kernel = local;
+      m_local_kernel = true;
+    }
+  }
+
+  array<Index, NumDims> m_inputStride;
+  array<Index, NumDims> m_outputStride;
+
+  array<Index, NumKernelDims> m_indexStride;
+  array<Index, NumKernelDims> m_kernelStride;
+  TensorEvaluator<InputArgType, ThreadPoolDevice> m_inputImpl;
+  TensorEvaluator<KernelArgType, ThreadPoolDevice> m_kernelImpl;
+  Dimensions m_dimensions;
+
+  KernelArgType m_kernelArg;
+  EvaluatorPointerType m_buf;
+  const Scalar* m_kernel;
+  bool m_local_kernel;
+  const ThreadPoolDevice& m_device;
+};
+#endif  // EIGEN_USE_THREADS
+
 
 // Use an optimized implementation of the evaluation code for GPUs whenever possible.
 #if defined(EIGEN_USE_GPU) && defined(EIGEN_GPUCC)
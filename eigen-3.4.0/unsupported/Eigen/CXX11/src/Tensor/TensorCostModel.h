@@ -154,6 +154,126 @@ class TensorOpCost {
   double compute_cycles_;
 };
 
+// Parameters of TensorCostModel, in device cycles. The defaults were tuned on
+// Haswell servers. calibrateTensorCostModel() (see
+// TensorCostModelCalibration.h) measures them on the host, and they can be
+// saved to a profile file that is loaded at startup: if the
+// EIGEN_TENSOR_COST_PROFILE environment variable names a profile file, the
+// first cost model query loads it.
+struct TensorCostModelParameters {
+  TensorCostModelParameters()
+      : load_cycles(1.0 / 64 * 11),
+        store_cycles(1.0 / 64 * 11),
+        compute_cycles(1),
+        startup_cycles(100000),
+        per_thread_cycles(100000),
+        task_size(40000) {}
+
+  // Cost of memory fetches from L2 cache, per byte. 64 is typical cache line
+  // size, 11 is L2 cache latency on Haswell.
+  double load_cycles;
+  double store_cycles;
+  // Scaling from Eigen compute cost to device cycles.
+  double compute_cycles;
+  // Cost of the work that makes it worth starting a parallel evaluation, and
+  // of the work each additional thread needs to be worth it.
+  double startup_cycles;
+  double per_thread_cycles;
+  // Cost of an ideally sized parallel task.
+  double task_size;
+
+  bool valid() const {
+    for (int i = 0; i < kNumFields; ++i) {
+      if (!(field(i) >= 0) || !(numext::isfinite)(field(i))) return false;
+    }
+    return load_cycles > 0 && store_cycles > 0 && compute_cycles > 0 &&
+           per_thread_cycles > 0 && task_size > 0;
+  }
+
+  // Reads a profile file made of "name value" lines, with the numbers in the
+  // classic "C" locale. Empty lines, lines starting with '#' and unknown names
+  // are ignored. Returns false, leaving the parameters unchanged, if the file
+  // can't be read or holds invalid values.
+  bool load(const std::string& path) {
+    std::ifstream in(path.c_str());
+    if (!in) return false;
+    in.imbue(std::locale::classic());
+    TensorCostModelParameters params = *this;
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      fields.imbue(std::locale::classic());
+      std::string name;
+      double value;
+      if (!(fields >> name) || name[0] == '#') continue;
+      if (!(fields >> value) || !(fields >> std::ws).eof()) return false;
+      for (int i = 0; i < kNumFields; ++i) {
+        if (name == fieldName(i)) params.field(i) = value;
+      }
+    }
+    if (!params.valid()) return false;
+    *this = params;
+    return true;
+  }
+
+  // Writes the parameters in the format read by load().
+  bool save(const std::string& path) const {
+    std::ofstream out(path.c_str());
+    out.imbue(std::locale::classic());
+    out.precision(17);
+    out << "# Eigen TensorCostModel profile\n";
+    for (int i = 0; i < kNumFields; ++i) {
+      out << fieldName(i) << " " << field(i) << "\n";
+    }
+    out.flush();
+    return static_cast<bool>(out);
+  }
+
+  // Returns the parameters used by TensorCostModel. They are the defaults,
+  // or the profile named by EIGEN_TENSOR_COST_PROFILE if it can be loaded.
+  static const TensorCostModelParameters& get() { return instance(); }
+
+  // Replaces the parameters used by TensorCostModel. This is not synchronized
+  // with the evaluation of expressions: call it at startup.
+  static void set(const TensorCostModelParameters& params) {
+    eigen_assert(params.valid());
+    instance() = params;
+  }
+
+ private:
+  static const int kNumFields = 6;
+
+  static const char* fieldName(int i) {
+    static const char* const names[kNumFields] = {
+        "load_cycles",       "store_cycles", "compute_cycles", "startup_cycles",
+        "per_thread_cycles", "task_size"};
+    return names[i];
+  }
+
+  // The parameter named fieldName(i).
+  double& field(int i) {
+    double* const fields[kNumFields] = {&load_cycles,    &store_cycles,
+                                        &compute_cycles, &startup_cycles,
+                                        &per_thread_cycles, &task_size};
+    return *fields[i];
+  }
+  double field(int i) const {
+    return const_cast<TensorCostModelParameters*>(this)->field(i);
+  }
+
+  static TensorCostModelParameters& instance() {
+    static TensorCostModelParameters params = fromEnvironment();
+    return params;
+  }
+
+  static TensorCostModelParameters fromEnvironment() {
+    TensorCostModelParameters params;
+    const char* path = std::getenv("EIGEN_TENSOR_COST_PROFILE");
+    if (path != NULL && path[0] != '\0') params.load(path);
+    return params;
+  }
+};
+
 // TODO(rmlarsen): Implement a policy that chooses an "optimal" number of theads
 // in [1:max_threads] instead of just switching multi-threading off for small
 // work units.
@@ -163,7 +283,8 @@ class TensorCostModel {
   // Scaling from Eigen compute cost to device cycles.
   static const int kDeviceCyclesPerComputeCycle = 1;
 
- // Costs in device cycles.
+ // Costs in device cycles. These are the defaults, the host code uses
+ // TensorCostModelParameters::get().
   static const int kStartupCycles = 100000;
   static const int kPerThreadCycles = 100000;
   static const int kTaskSize = 40000;
@@ -174,7 +295,7 @@ class TensorCostModel {
   static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE int numThreads(
       double output_size, const TensorOpCost& cost_per_coeff, int max_threads) {
     double cost = totalCost(output_size, cost_per_coeff);
-    double threads = (cost - kStartupCycles) / kPerThreadCycles + 0.9;
+    double threads = (cost - startupCycles()) / perThreadCycles() + 0.9;
     // Make sure we don't invoke undefined behavior when we convert to an int.
     threads = numext::mini<double>(threads, GenericNumTraits<int>::highest());
     return numext::mini(max_threads,
@@ -186,7 +307,7 @@ class TensorCostModel {
   // granularity needs to be increased to mitigate parallelization overheads.
   static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double taskSize(
       double output_size, const TensorOpCost& cost_per_coeff) {
-    return totalCost(output_size, cost_per_coeff) / kTaskSize;
+    return totalCost(output_size, cost_per_coeff) / taskCycles();
   }
 
   static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double totalCost(
@@ -200,13 +321,46 @@ class TensorCostModel {
     // And for the target time range, L2 seems to be what matters. Data set
     // fitting into L1 is too small to take noticeable time. Data set fitting
     // only into L3 presumably will take more than 10ms to load and process.
+    // The load/store costs default to a 64 bytes cache line loaded with the
+    // 11 cycles L2 latency of Haswell, see TensorCostModelParameters.
+#if defined(EIGEN_GPU_COMPILE_PHASE) || defined(SYCL_DEVICE_ONLY)
     const double kLoadCycles = 1.0 / 64 * 11;
     const double kStoreCycles = 1.0 / 64 * 11;
     // Scaling from Eigen compute cost to device cycles.
     return output_size *
         cost_per_coeff.total_cost(kLoadCycles, kStoreCycles,
                                   kDeviceCyclesPerComputeCycle);
+#else
+    const TensorCostModelParameters& params = TensorCostModelParameters::get();
+    return output_size *
+        cost_per_coeff.total_cost(params.load_cycles, params.store_cycles,
+                                  params.compute_cycles);
+#endif
+  }
+
+ private:
+  // Device code has no access to the host parameters, and uses the defaults.
+#if defined(EIGEN_GPU_COMPILE_PHASE) || defined(SYCL_DEVICE_ONLY)
+  static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double startupCycles() {
+    return kStartupCycles;
+  }
+  static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double perThreadCycles() {
+    return kPerThreadCycles;
+  }
+  static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double taskCycles() {
+    return kTaskSize;
+  }
+#else
+  static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double startupCycles() {
+    return TensorCostModelParameters::get().startup_cycles;
+  }
+  static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double perThreadCycles() {
+    return TensorCostModelParameters::get().per_thread_cycles;
+  }
+  static EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE double taskCycles() {
+    return TensorCostModelParameters::get().task_size;
   }
+#endif
 };
 
 }  // namespace Eigen
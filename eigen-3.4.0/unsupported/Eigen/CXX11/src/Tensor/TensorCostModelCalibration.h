@@ -0,0 +1,174 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_CXX11_TENSOR_TENSOR_COST_MODEL_CALIBRATION_H
+#define EIGEN_CXX11_TENSOR_TENSOR_COST_MODEL_CALIBRATION_H
+
+// calibration of the cost model for the thread pool device
+#ifdef EIGEN_USE_THREADS
+
+namespace Eigen {
+
+namespace internal {
+
+// Returns the median wall time of f() in nanoseconds.
+template <typename Function>
+double cost_model_median_nanos(Function f, int runs) {
+  typedef std::chrono::steady_clock Clock;
+  std::vector<double> times(runs);
+  for (int i = 0; i < runs; ++i) {
+    const Clock::time_point start = Clock::now();
+    f();
+    times[i] =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  }
+  std::nth_element(times.begin(), times.begin() + runs / 2, times.end());
+  return times[runs / 2];
+}
+
+// Evaluates dst = expr on the calling thread, and records the time it takes
+// per coefficient along with the cost per coefficient the cost model assigns
+// to it.
+template <typename Dst, typename Expr>
+void cost_model_sample(Dst& dst, const Expr& expr, int runs,
+                       std::vector<TensorOpCost>* costs,
+                       std::vector<double>* nanos) {
+  typedef TensorAssignOp<Dst, const Expr> Assign;
+  typedef TensorEvaluator<const Assign, DefaultDevice> Evaluator;
+  DefaultDevice device;
+  const Assign assign(dst, expr);
+  const Evaluator evaluator(assign, device);
+  costs->push_back(evaluator.costPerCoeff(Evaluator::PacketAccess));
+  dst.device(device) = expr;  // warm up the caches
+  nanos->push_back(
+      cost_model_median_nanos([&]() { dst.device(device) = expr; }, runs) /
+      static_cast<double>(dst.size()));
+}
+
+// Returns value clamped to [reference / kRange, reference * kRange], so that
+// a noisy measurement can't make the cost model degenerate.
+inline double cost_model_clamp(double value, double reference) {
+  const double kRange = 16;
+  return numext::mini(numext::maxi(value, reference / kRange),
+                      reference * kRange);
+}
+
+}  // namespace internal
+
+// Measures the TensorCostModel parameters on the host:
+//
+// - The load/store and compute costs are fitted by least squares to the
+//   single threaded evaluation times of a few coefficient-wise expressions,
+//   against the cost per coefficient that the evaluators report for them. As
+//   in the default model, the operands fit in L2 cache, and the unit is the
+//   time of one Eigen compute cycle (compute_cycles stays 1).
+// - The startup and per thread costs are the overhead of dispatching work to
+//   the pool of `device` and waiting for it, measured with empty tasks, and
+//   scaled so that it is at most a fifth of the work it enables. The task
+//   size keeps its default ratio to the per thread cost.
+//
+// Each result is clamped to a factor 16 of its default. The calibration takes
+// a fraction of a second. Its result is meant to be saved as the profile of
+// the host:
+//
+//   TensorCostModelParameters params = calibrateTensorCostModel(device);
+//   params.save("/etc/eigen_cost_profile");
+//   TensorCostModelParameters::set(params);
+//
+// Later runs load it at startup with
+// EIGEN_TENSOR_COST_PROFILE=/etc/eigen_cost_profile.
+inline TensorCostModelParameters calibrateTensorCostModel(
+    const ThreadPoolDevice& device) {
+  const TensorCostModelParameters defaults;
+  TensorCostModelParameters params;
+
+  // Memory and compute costs.
+  const Index size = 16384;
+  const int runs = 51;
+  Tensor<float, 1> a(size), b(size), c(size), dst(size);
+  a.setRandom();
+  b.setRandom();
+  c.setRandom();
+  std::vector<TensorOpCost> costs;
+  std::vector<double> nanos;
+  internal::cost_model_sample(dst, a, runs, &costs, &nanos);
+  internal::cost_model_sample(dst, a + b, runs, &costs, &nanos);
+  internal::cost_model_sample(dst, a * b + c, runs, &costs, &nanos);
+  internal::cost_model_sample(dst, a.exp(), runs, &costs, &nanos);
+  internal::cost_model_sample(dst, a.tanh(), runs, &costs, &nanos);
+  internal::cost_model_sample(dst, a.abs().sqrt() + b.exp(), runs, &costs,
+                              &nanos);
+
+  // nanos = nanos_per_byte * bytes + nanos_per_cycle * cycles
+  double mm = 0, mc = 0, cc = 0, mt = 0, ct = 0;
+  for (size_t i = 0; i < costs.size(); ++i) {
+    const double m = costs[i].bytes_loaded() + costs[i].bytes_stored();
+    const double k = costs[i].compute_cycles();
+    mm += m * m;
+    mc += m * k;
+    cc += k * k;
+    mt += m * nanos[i];
+    ct += k * nanos[i];
+  }
+  const double det = mm * cc - mc * mc;
+  const double nanos_per_byte = det > 0 ? (cc * mt - mc * ct) / det : 0;
+  const double nanos_per_cycle = det > 0 ? (mm * ct - mc * mt) / det : 0;
+  double unit;
+  if (nanos_per_cycle > 0) {
+    unit = nanos_per_cycle;
+  } else if (nanos_per_byte > 0) {
+    unit = nanos_per_byte / defaults.load_cycles;
+  } else {
+    return defaults;
+  }
+  if (nanos_per_byte > 0) {
+    params.load_cycles =
+        internal::cost_model_clamp(nanos_per_byte / unit, defaults.load_cycles);
+    params.store_cycles = internal::cost_model_clamp(nanos_per_byte / unit,
+                                                     defaults.store_cycles);
+  }
+  params.compute_cycles = 1;
+
+  // Dispatch overheads: one empty task, and one empty task per thread.
+  ThreadPoolInterface* pool = device.getPool();
+  const int num_threads = device.numThreads();
+  const auto region = [pool](int tasks) {
+    Barrier barrier(static_cast<unsigned>(tasks));
+    for (int i = 0; i < tasks; ++i) {
+      pool->Schedule([&barrier]() { barrier.Notify(); });
+    }
+    barrier.Wait();
+  };
+  region(num_threads);
+  const int dispatch_runs = 201;
+  const double dispatch = internal::cost_model_median_nanos(
+      [&region]() { region(1); }, dispatch_runs);
+  const double per_task =
+      num_threads > 1
+          ? (internal::cost_model_median_nanos(
+                 [&region, num_threads]() { region(num_threads); },
+                 dispatch_runs) -
+             dispatch) /
+                (num_threads - 1)
+          : dispatch;
+
+  const double kOverheadRatio = 5;
+  params.startup_cycles = internal::cost_model_clamp(
+      kOverheadRatio * dispatch / unit, defaults.startup_cycles);
+  params.per_thread_cycles = internal::cost_model_clamp(
+      kOverheadRatio * numext::maxi(dispatch, per_task) / unit,
+      defaults.per_thread_cycles);
+  params.task_size = params.per_thread_cycles *
+                     (defaults.task_size / defaults.per_thread_cycles);
+  eigen_assert(params.valid());
+  return params;
+}
+
+}  // namespace Eigen
+
+#endif  // EIGEN_USE_THREADS
+#endif  // EIGEN_CXX11_TENSOR_TENSOR_COST_MODEL_CALIBRATION_H
@@ -49,6 +49,62 @@ class Allocator {
   virtual void deallocate(void* buffer) const = 0;
 };
 
+// An allocator returning fresh, never touched, pages for the large buffers.
+// With the first-touch memory policy of Linux, each page is then placed on the
+// NUMA node of the thread writing it first, for instance the thread packing
+// its blocks in a contraction, rather than wherever a recycled heap block
+// happens to be. Each such allocation costs a system call and page faults, so
+// it only pays off with threads pinned on a multi-socket machine, see
+// TopologyThreadPool. The buffers smaller than min_mapped_bytes, and all of
+// them on other systems, come from aligned_malloc.
+class FirstTouchAllocator : public Allocator {
+ public:
+  explicit FirstTouchAllocator(size_t min_mapped_bytes = 1 << 20)
+      : min_mapped_bytes_(min_mapped_bytes) {}
+
+  void* allocate(size_t num_bytes) const EIGEN_OVERRIDE {
+    // The header keeps the mapped size (0 for aligned_malloc) and the
+    // alignment of the buffer.
+    const size_t total = num_bytes + kHeaderSize;
+    char* block = NULL;
+    size_t mapped = 0;
+#if defined(__linux__)
+    if (num_bytes >= min_mapped_bytes_) {
+      void* p = ::mmap(NULL, total, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p != MAP_FAILED) {
+        block = static_cast<char*>(p);
+        mapped = total;
+      }
+    }
+#endif
+    if (block == NULL) {
+      block = static_cast<char*>(internal::aligned_malloc(total));
+    }
+    *reinterpret_cast<size_t*>(block) = mapped;
+    return block + kHeaderSize;
+  }
+
+  void deallocate(void* buffer) const EIGEN_OVERRIDE {
+    if (buffer == NULL) return;
+    char* block = static_cast<char*>(buffer) - kHeaderSize;
+    const size_t mapped = *reinterpret_cast<size_t*>(block);
+#if defined(__linux__)
+    if (mapped != 0) {
+      ::munmap(block, mapped);
+      return;
+    }
+#endif
+    eigen_assert(mapped == 0);
+    internal::aligned_free(block);
+  }
+
+ private:
+  static const size_t kHeaderSize = 64;
+  EIGEN_STATIC_ASSERT(kHeaderSize >= EIGEN_MAX_ALIGN_BYTES, YOU_MADE_A_PROGRAMMING_MISTAKE)
+  const size_t min_mapped_bytes_;
+};
+
 // Build a thread pool device on top the an existing pool of threads.
 struct ThreadPoolDevice {
   // The ownership of the thread pool remains with the caller.
@@ -19,7 +19,6 @@ namespace Eigen {
   *
   * TODO:
   * Vectorize the Cooley Tukey and the Bluestein algorithm
-  * Add support for multithreaded evaluation
   * Improve the performance on GPU
   */
 
@@ -54,6 +53,118 @@ template <> struct PartOf<ImagPart> {
 };
 
 namespace internal {
+
+// Precomputed data of Bluestein's algorithm for one line length and
+// direction: the chirp t_n = exp(sqrt(-1) * pi * n^2 / line_len) and the
+// forward FFT of the zero padded chirp filter.
+template <typename ComplexScalar>
+struct TensorFFTBluesteinPlan {
+  std::vector<ComplexScalar> chirp;
+  std::vector<ComplexScalar> filter_fft;
+};
+
+// Maximum number of Bluestein plans kept by TensorFFTPlanCache, per scalar
+// type.
+#ifndef EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE
+#define EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE 16
+#endif
+
+// Process wide cache of the most recently used Bluestein plans, keyed by
+// (line length, direction); the scalar type is the template argument. It
+// holds at most EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE plans and evicts the least
+// recently used one. The callers share the ownership of the plans, so an
+// evicted plan stays valid until the evaluations using it are done.
+//
+// Only non power of two lengths use a plan, and the cache is searched once
+// per FFT pass, not per line.
+template <typename ComplexScalar>
+class TensorFFTPlanCache {
+ public:
+  typedef TensorFFTBluesteinPlan<ComplexScalar> Plan;
+  typedef std::shared_ptr<const Plan> PlanPtr;
+
+  // Returns the plan for the key, or a null pointer.
+  static PlanPtr find(Index line_len, int direction) {
+    std::lock_guard<std::mutex> lock(mutex());
+    typename PlanList::iterator it = lookup(Key(line_len, direction));
+    return it == plans().end() ? PlanPtr() : it->second;
+  }
+
+  // Adds the plan to the cache. If another thread inserted a plan for the
+  // same key in the meantime, that one is kept and returned.
+  static PlanPtr insert(Index line_len, int direction, const PlanPtr& plan) {
+    PlanPtr evicted;
+    std::lock_guard<std::mutex> lock(mutex());
+    typename PlanList::iterator it = lookup(Key(line_len, direction));
+    if (it != plans().end()) return it->second;
+    plans().push_front(Entry(Key(line_len, direction), plan));
+    if (plans().size() > EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE) {
+      evicted = plans().back().second;
+      plans().pop_back();
+    }
+    return plan;
+  }
+
+  static size_t size() {
+    std::lock_guard<std::mutex> lock(mutex());
+    return plans().size();
+  }
+
+  static void clear() {
+    PlanList cleared;
+    std::lock_guard<std::mutex> lock(mutex());
+    cleared.swap(plans());
+  }
+
+ private:
+  typedef std::pair<Index, int> Key;
+  typedef std::pair<Key, PlanPtr> Entry;
+  // Most recently used first.
+  typedef std::list<Entry> PlanList;
+
+  // Finds the key and moves it to the front. The mutex must be held.
+  static typename PlanList::iterator lookup(const Key& key) {
+    PlanList& list = plans();
+    for (typename PlanList::iterator it = list.begin(); it != list.end(); ++it) {
+      if (it->first == key) {
+        list.splice(list.begin(), list, it);
+        return it;
+      }
+    }
+    return list.end();
+  }
+
+  static std::mutex& mutex() {
+    static std::mutex m;
+    return m;
+  }
+  static PlanList& plans() {
+    static PlanList m;
+    return m;
+  }
+};
+
+// Runs f(first, last) over the [0, n) independent lines of one FFT pass. On a
+// ThreadPoolDevice the lines are split across the pool.
+template <typename Device>
+struct TensorFFTLineExecutor {
+  template <typename Function>
+  static void run(const Device&, Index n, const TensorOpCost&, Function f) {
+    f(0, n);
+  }
+};
+
+#ifdef EIGEN_USE_THREADS
+template <>
+struct TensorFFTLineExecutor<ThreadPoolDevice> {
+  template <typename Function>
+  static void run(const ThreadPoolDevice& device, Index n,
+                  const TensorOpCost& cost, Function f) {
+    device.parallelFor(n, cost, f);
+  }
+};
+#endif  // EIGEN_USE_THREADS
+
 template <typename FFT, typename XprType, int FFTResultType, int FFTDir>
 struct traits<TensorFFTOp<FFT, XprType, FFTResultType, FFTDir> > : public traits<XprType> {
   typedef traits<XprType> XprTraits;
@@ -129,6 +240,8 @@ struct TensorEvaluator<const TensorFFTOp<FFT, ArgType, FFTResultType, FFTDir>, D
   static const int PacketSize = internal::unpacket_traits<PacketReturnType>::size;
     typedef StorageMemory<CoeffReturnType, Device> Storage;
   typedef typename Storage::Type EvaluatorPointerType;
+  typedef internal::TensorFFTBluesteinPlan<ComplexScalar> BluesteinPlan;
+  typedef typename internal::TensorFFTPlanCache<ComplexScalar>::PlanPtr BluesteinPlanPtr;
 
   enum {
     IsAligned = false,
@@ -226,87 +339,92 @@ struct TensorEvaluator<const TensorFFTOp<FFT, ArgType, FFTResultType, FFTDir>, D
       eigen_assert(dim >= 0 && dim < NumDims);
       Index line_len = m_dimensions[dim];
       eigen_assert(line_len >= 1);
-      ComplexScalar* line_buf = (ComplexScalar*)m_device.allocate(sizeof(ComplexScalar) * line_len);
       const bool is_power_of_two = isPowerOfTwo(line_len);
       const Index good_composite = is_power_of_two ? 0 : findGoodComposite(line_len);
       const Index log_len = is_power_of_two ? getLog2(line_len) : getLog2(good_composite);
+      const BluesteinPlanPtr plan_ref = is_power_of_two ? BluesteinPlanPtr() : getBluesteinPlan(line_len, good_composite, log_len);
+      const BluesteinPlan* plan = plan_ref.get();
+
+      // The first pass over a real input transforms two lines at once: one is
+      // packed into the real part and the other one into the imaginary part,
+      // and the two spectra are separated using their conjugate symmetry.
+      const bool pack_real_lines = i == 0 && internal::is_same<InputScalar, RealScalar>::value;
+      const Index num_lines = m_size / line_len;
+      const Index num_tasks = pack_real_lines ? (num_lines + 1) / 2 : num_lines;
+      const Index stride = m_strides[dim];
+
+      const double transform_len = is_power_of_two ? line_len : 2 * good_composite;
+      const double line_bytes = static_cast<double>(sizeof(ComplexScalar) * line_len * (pack_real_lines ? 2 : 1));
+      const TensorOpCost line_cost(line_bytes, line_bytes,
+                                   transform_len * (log_len + 1) *
+                                       (3 * TensorOpCost::AddCost<RealScalar>() +
+                                        2 * TensorOpCost::MulCost<RealScalar>()));
+
+      auto process_lines = [&](Index first, Index last) {
+        ComplexScalar* line_buf = (ComplexScalar*)m_device.allocate(sizeof(ComplexScalar) * line_len);
+        ComplexScalar* a = is_power_of_two ? NULL : (ComplexScalar*)m_device.allocate(sizeof(ComplexScalar) * good_composite);
+
+        for (Index task = first; task < last; ++task) {
+          if (pack_real_lines) {
+            const Index base_offset = getBaseOffsetFromIndex(2 * task, dim);
+            const bool has_pair = 2 * task + 1 < num_lines;
+            const Index pair_offset = has_pair ? getBaseOffsetFromIndex(2 * task + 1, dim) : 0;
+
+            // get data into line_buf
+            for (Index j = 0; j < line_len; ++j) {
+              line_buf[j] = ComplexScalar(buf[base_offset + j * stride].real(),
+                                          has_pair ? buf[pair_offset + j * stride].real() : RealScalar(0));
+            }
+
+            // process the line
+            processDataLine(line_buf, line_len, log_len, good_composite, a, plan);
+
+            // X[k] = (Z[k] + conj(Z[-k])) / 2 and Y[k] = (Z[k] - conj(Z[-k])) / 2i
+            const RealScalar scale = (FFTDir == FFT_FORWARD) ? RealScalar(0.5) : RealScalar(0.5) / line_len;
+            for (Index j = 0; j < line_len; ++j) {
+              const ComplexScalar z = line_buf[j];
+              const ComplexScalar z_conj = numext::conj(line_buf[j == 0 ? 0 : line_len - j]);
+              buf[base_offset + j * stride] = (z + z_conj) * scale;
+              if (has_pair) {
+                buf[pair_offset + j * stride] = (z - z_conj) * ComplexScalar(0, -scale);
+              }
+            }
+            continue;
+          }
 
-      ComplexScalar* a = is_power_of_two ? NULL : (ComplexScalar*)m_device.allocate(sizeof(ComplexScalar) * good_composite);
-      ComplexScalar* b = is_power_of_two ? NULL : (ComplexScalar*)m_device.allocate(sizeof(ComplexScalar) * good_composite);
-      ComplexScalar* pos_j_base_powered = is_power_of_two ? NULL : (ComplexScalar*)m_device.allocate(sizeof(ComplexScalar) * (line_len + 1));
-      if (!is_power_of_two) {
-        // Compute twiddle factors
-        //   t_n = exp(sqrt(-1) * pi * n^2 / line_len)
-        // for n = 0, 1,..., line_len-1.
-        // For n > 2 we use the recurrence t_n = t_{n-1}^2 / t_{n-2} * t_1^2
-
-        // The recurrence is correct in exact arithmetic, but causes
-        // numerical issues for large transforms, especially in
-        // single-precision floating point.
-        //
-        // pos_j_base_powered[0] = ComplexScalar(1, 0);
-        // if (line_len > 1) {
-        //   const ComplexScalar pos_j_base = ComplexScalar(
-        //       numext::cos(M_PI / line_len), numext::sin(M_PI / line_len));
-        //   pos_j_base_powered[1] = pos_j_base;
-        //   if (line_len > 2) {
-        //     const ComplexScalar pos_j_base_sq = pos_j_base * pos_j_base;
-        //     for (int i = 2; i < line_len + 1; ++i) {
-        //       pos_j_base_powered[i] = pos_j_base_powered[i - 1] *
-        //           pos_j_base_powered[i - 1] /
-        //           pos_j_base_powered[i - 2] *
-        //           pos_j_base_sq;
-        //     }
-        //   }
-        // }
-        // TODO(rmlarsen): Find a way to use Eigen's vectorized sin
-        // and cosine functions here.
-        for (int j = 0; j < line_len + 1; ++j) {
-          double arg = ((EIGEN_PI * j) * j) / line_len;
-          std::complex<double> tmp(numext::cos(arg), numext::sin(arg));
-          pos_j_base_powered[j] = static_cast<ComplexScalar>(tmp);
-        }
-      }
+          const Index base_offset = getBaseOffsetFromIndex(task, dim);
 
-      for (Index partial_index = 0; partial_index < m_size / line_len; ++partial_index) {
-        const Index base_offset = getBaseOffsetFromIndex(partial_index, dim);
-
-        // get data into line_buf
-        const Index stride = m_strides[dim];
-        if (stride == 1) {
-          m_device.memcpy(line_buf, &buf[base_offset], line_len*sizeof(ComplexScalar));
-        } else {
-          Index offset = base_offset;
-          for (int j = 0; j < line_len; ++j, offset += stride) {
-            line_buf[j] = buf[offset];
+          // get data into line_buf
+          if (stride == 1) {
+            m_device.memcpy(line_buf, &buf[base_offset], line_len*sizeof(ComplexScalar));
+          } else {
+            Index offset = base_offset;
+            for (int j = 0; j < line_len; ++j, offset += stride) {
+              line_buf[j] = buf[offset];
+            }
           }
-        }
 
-        // process the line
-        if (is_power_of_two) {
-          processDataLineCooleyTukey(line_buf, line_len, log_len);
-        }
-        else {
-          processDataLineBluestein(line_buf, line_len, good_composite, log_len, a, b, pos_j_base_powered);
+          // process the line
+          processDataLine(line_buf, line_len, log_len, good_composite, a, plan);
+
+          // write back
+          if (FFTDir == FFT_FORWARD && stride == 1) {
+            m_device.memcpy(&buf[base_offset], line_buf, line_len*sizeof(ComplexScalar));
+          } else {
+            Index offset = base_offset;
+            const ComplexScalar div_factor =  ComplexScalar(1.0 / line_len, 0);
+            for (int j = 0; j < line_len; ++j, offset += stride) {
+               buf[offset] = (FFTDir == FFT_FORWARD) ? line_buf[j] : line_buf[j] * div_factor;
+            }
+          }
         }
 
-        // write back
-        if (FFTDir == FFT_FORWARD && stride == 1) {
-          m_device.memcpy(&buf[base_offset], line_buf, line_len*sizeof(ComplexScalar));
-        } else {
-          Index offset = base_offset;
-          const ComplexScalar div_factor =  ComplexScalar(1.0 / line_len, 0);
-          for (int j = 0; j < line_len; ++j, offset += stride) {
-             buf[offset] = (FFTDir == FFT_FORWARD) ? line_buf[j] : line_buf[j] * div_factor;
-          }
+        m_device.deallocate(line_buf);
+        if (!is_power_of_two) {
+          m_device.deallocate(a);
         }
-      }
-      m_device.deallocate(line_buf);
-      if (!is_power_of_two) {
-        m_device.deallocate(a);
-        m_device.deallocate(b);
-        m_device.deallocate(pos_j_base_powered);
-      }
+      };
+      internal::TensorFFTLineExecutor<Device>::run(m_device, num_tasks, line_cost, process_lines);
     }
 
     if(!write_to_out) {
@@ -342,24 +460,62 @@ struct TensorEvaluator<const TensorFFTOp<FFT, ArgType, FFTResultType, FFTDir>, D
     compute_1D_Butterfly<FFTDir>(line_buf, line_len, log_len);
   }
 
-  // Call Bluestein's FFT algorithm, m is a good composite number greater than (2 * n - 1), used as the padding length
-  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE void processDataLineBluestein(ComplexScalar* line_buf, Index line_len, Index good_composite, Index log_len, ComplexScalar* a, ComplexScalar* b, const ComplexScalar* pos_j_base_powered) {
-    Index n = line_len;
-    Index m = good_composite;
-    ComplexScalar* data = line_buf;
-
-    for (Index i = 0; i < n; ++i) {
-      if(FFTDir == FFT_FORWARD) {
-        a[i] = data[i] * numext::conj(pos_j_base_powered[i]);
-      }
-      else {
-        a[i] = data[i] * pos_j_base_powered[i];
-      }
+  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE void processDataLine(ComplexScalar* line_buf, Index line_len, Index log_len, Index good_composite, ComplexScalar* a, const BluesteinPlan* plan) {
+    if (plan == NULL) {
+      processDataLineCooleyTukey(line_buf, line_len, log_len);
     }
-    for (Index i = n; i < m; ++i) {
-      a[i] = ComplexScalar(0, 0);
+    else {
+      processDataLineBluestein(line_buf, line_len, good_composite, log_len, a, *plan);
+    }
+  }
+
+  // Returns the cached Bluestein plan for lines of length line_len, building
+  // it on first use.
+  BluesteinPlanPtr getBluesteinPlan(Index line_len, Index good_composite, Index log_len) {
+    typedef internal::TensorFFTPlanCache<ComplexScalar> PlanCache;
+    BluesteinPlanPtr cached = PlanCache::find(line_len, FFTDir);
+    if (cached) return cached;
+
+    std::shared_ptr<BluesteinPlan> plan = std::make_shared<BluesteinPlan>();
+    const Index n = line_len;
+    const Index m = good_composite;
+
+    // Compute twiddle factors
+    //   t_n = exp(sqrt(-1) * pi * n^2 / line_len)
+    // for n = 0, 1,..., line_len-1.
+    // For n > 2 we use the recurrence t_n = t_{n-1}^2 / t_{n-2} * t_1^2
+
+    // The recurrence is correct in exact arithmetic, but causes
+    // numerical issues for large transforms, especially in
+    // single-precision floating point.
+    //
+    // pos_j_base_powered[0] = ComplexScalar(1, 0);
+    // if (line_len > 1) {
+    //   const ComplexScalar pos_j_base = ComplexScalar(
+    //       numext::cos(M_PI / line_len), numext::sin(M_PI / line_len));
+    //   pos_j_base_powered[1] = pos_j_base;
+    //   if (line_len > 2) {
+    //     const ComplexScalar pos_j_base_sq = pos_j_base * pos_j_base;
+    //     for (int i = 2; i < line_len + 1; ++i) {
+    //       pos_j_base_powered[i] = pos_j_base_powered[i - 1] *
+    //           pos_j_base_powered[i - 1] /
+    //           pos_j_base_powered[i - 2] *
+    //           pos_j_base_sq;
+    //     }
+    //   }
+    // }
+    // TODO(rmlarsen): Find a way to use Eigen's vectorized sin
+    // and cosine functions here.
+    std::vector<ComplexScalar>& pos_j_base_powered = plan->chirp;
+    pos_j_base_powered.resize(n + 1);
+    for (int j = 0; j < n + 1; ++j) {
+      double arg = ((EIGEN_PI * j) * j) / n;
+      std::complex<double> tmp(numext::cos(arg), numext::sin(arg));
+      pos_j_base_powered[j] = static_cast<ComplexScalar>(tmp);
     }
 
+    std::vector<ComplexScalar>& b = plan->filter_fft;
+    b.resize(m);
     for (Index i = 0; i < n; ++i) {
       if(FFTDir == FFT_FORWARD) {
         b[i] = pos_j_base_powered[i];
@@ -380,12 +536,35 @@ struct TensorEvaluator<const TensorFFTOp<FFT, ArgType, FFTResultType, FFTDir>, D
       }
     }
 
+    scramble_FFT(&b[0], m);
+    compute_1D_Butterfly<FFT_FORWARD>(&b[0], m, log_len);
+
+    return PlanCache::insert(line_len, FFTDir, plan);
+  }
+
+  // Call Bluestein's FFT algorithm, m is a good composite number greater than (2 * n - 1), used as the padding length
+  EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE void processDataLineBluestein(ComplexScalar* line_buf, Index line_len, Index good_composite, Index log_len, ComplexScalar* a, const BluesteinPlan& plan) {
+    Index n = line_len;
+    Index m = good_composite;
+    ComplexScalar* data = line_buf;
+    const ComplexScalar* pos_j_base_powered = &plan.chirp[0];
+    const ComplexScalar* b = &plan.filter_fft[0];
+
+    for (Index i = 0; i < n; ++i) {
+      if(FFTDir == FFT_FORWARD) {
+        a[i] = data[i] * numext::conj(pos_j_base_powered[i]);
+      }
+      else {
+        a[i] = data[i] * pos_j_base_powered[i];
+      }
+    }
+    for (Index i = n; i < m; ++i) {
+      a[i] = ComplexScalar(0, 0);
+    }
+
     scramble_FFT(a, m);
     compute_1D_Butterfly<FFT_FORWARD>(a, m, log_len);
 
-    scramble_FFT(b, m);
-    compute_1D_Butterfly<FFT_FORWARD>(b, m, log_len);
-
     for (Index i = 0; i < m; ++i) {
       a[i] *= b[i];
     }
@@ -552,6 +731,8 @@ struct TensorEvaluator<const TensorFFTOp<FFT, ArgType, FFTResultType, FFTDir>, D
   }
 
   EIGEN_DEVICE_FUNC EIGEN_STRONG_INLINE Index getBaseOffsetFromIndex(Index index, Index omitted_dim) const {
+    // A rank 1 tensor has a single line, starting at offset 0.
+    if (NumDims == 1) return index;
     Index result = 0;
 
     if (static_cast<int>(Layout) == static_cast<int>(ColMajor)) {
@@ -12,30 +12,49 @@
 
 namespace Eigen {
 
-template <typename Environment>
+// The pool collects the statistics returned by Stats() only when CollectStats
+// is true, e.g. ThreadPoolTempl<StlThreadEnvironment, true>.
+template <typename Environment, bool CollectStats = false>
 class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
  public:
   typedef typename Environment::Task Task;
   typedef RunQueue<Task, 1024> Queue;
+  typedef OverflowQueue<Task, 1024> Overflow;
 
   ThreadPoolTempl(int num_threads, Environment env = Environment())
       : ThreadPoolTempl(num_threads, true, env) {}
 
   ThreadPoolTempl(int num_threads, bool allow_spinning,
                   Environment env = Environment())
+      : ThreadPoolTempl(num_threads, allow_spinning, 0, env) {}
+
+  // The last num_reserved threads of the pool only run high priority tasks,
+  // so that these never wait behind long normal priority ones. At least one
+  // thread must be left for the normal priority tasks.
+  ThreadPoolTempl(int num_threads, bool allow_spinning, int num_reserved,
+                  Environment env = Environment())
       : env_(env),
         num_threads_(num_threads),
+        num_reserved_(num_reserved),
         allow_spinning_(allow_spinning),
         thread_data_(num_threads),
         all_coprimes_(num_threads),
         waiters_(num_threads),
+        worker_stats_(num_threads),
         global_steal_partition_(EncodePartition(0, num_threads_)),
         blocked_(0),
         spinning_(0),
+        reserved_spinning_(0),
+        high_priority_pending_(0),
         done_(false),
         cancelled_(false),
-        ec_(waiters_) {
+        external_overflow_pushes_(0),
+        ec_(waiters_),
+        reserved_ec_(waiters_) {
+    eigen_plain_assert(num_reserved_ >= 0);
+    eigen_plain_assert(num_reserved_ == 0 || num_reserved_ < num_threads_);
     waiters_.resize(num_threads_);
+    worker_stats_.resize(num_threads_);
     // Calculate coprimes of all numbers [1, num_threads].
     // Coprimes are used for random walks over all threads in Steal
     // and NonEmptyQueueIndex. Iteration is based on the fact that if we take
@@ -72,11 +91,15 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     // block, submit new work, unblock and otherwise live full life.
     if (!cancelled_) {
       ec_.Notify(true);
+      reserved_ec_.Notify(true);
     } else {
       // Since we were cancelled, there might be entries in the queues.
       // Empty them to prevent their destructor from asserting.
-      for (size_t i = 0; i < thread_data_.size(); i++) {
-        thread_data_[i].queue.Flush();
+      for (int band = 0; band < kNumPriorities; band++) {
+        for (size_t i = 0; i < thread_data_.size(); i++) {
+          thread_data_[i].queue[band].Flush();
+        }
+        overflow_[band].Flush();
       }
     }
     // Join threads explicitly (by destroying) to avoid destruction order within
@@ -99,28 +122,73 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
   }
 
   void Schedule(std::function<void()> fn) EIGEN_OVERRIDE {
-    ScheduleWithHint(std::move(fn), 0, num_threads_);
+    ScheduleWithHintAndPriority(std::move(fn), 0, num_threads_, kNormalPriority);
   }
 
   void ScheduleWithHint(std::function<void()> fn, int start,
                         int limit) override {
+    ScheduleWithHintAndPriority(std::move(fn), start, limit, kNormalPriority);
+  }
+
+  void ScheduleWithPriority(std::function<void()> fn,
+                            Priority priority) EIGEN_OVERRIDE {
+    ScheduleWithHintAndPriority(std::move(fn), 0, num_threads_, priority);
+  }
+
+  void ScheduleWithHintAndPriority(std::function<void()> fn, int start,
+                                   int limit, Priority priority) override {
+    if (CollectStats) {
+      fn = TimedFunction(std::move(fn), WorkerStats::Now(), this);
+    }
     Task t = env_.CreateTask(std::move(fn));
+    const int band = priority;
+    if (band == kHighPriority) {
+      // Counted before the push, so that it is never less than the number of
+      // queued high priority tasks.
+      high_priority_pending_.fetch_add(1, std::memory_order_relaxed);
+    }
     PerThread* pt = GetPerThread();
-    if (pt->pool == this) {
+    int queue_index;
+    if (pt->pool == this && (band == kHighPriority || !IsReserved(pt->thread_id))) {
       // Worker thread of this pool, push onto the thread's queue.
-      Queue& q = thread_data_[pt->thread_id].queue;
+      queue_index = pt->thread_id;
+      Queue& q = thread_data_[queue_index].queue[band];
       t = q.PushFront(std::move(t));
     } else {
       // A free-standing thread (or worker of another pool), push onto a random
       // queue.
       eigen_plain_assert(start < limit);
       eigen_plain_assert(limit <= num_threads_);
+      if (band == kNormalPriority && num_reserved_ > 0) {
+        // Keep normal priority tasks away from the reserved threads.
+        limit = numext::mini(limit, num_threads_ - num_reserved_);
+        if (start >= limit) {
+          start = 0;
+          limit = num_threads_ - num_reserved_;
+        }
+      }
       int num_queues = limit - start;
       int rnd = Rand(&pt->rand) % num_queues;
       eigen_plain_assert(start + rnd < limit);
-      Queue& q = thread_data_[start + rnd].queue;
+      queue_index = start + rnd;
+      Queue& q = thread_data_[queue_index].queue[band];
       t = q.PushBack(std::move(t));
     }
+    if (CollectStats) {
+      worker_stats_[queue_index].UpdateMaxQueueSize(thread_data_[queue_index].queue[band].Size());
+    }
+    if (t.f) {
+      // Push failed, hand the task over to the overflow queue rather than
+      // executing it on the calling thread.
+      if (CollectStats) {
+        if (pt->pool == this) {
+          worker_stats_[pt->thread_id].Add(ThreadPoolStats::kOverflowPushes);
+        } else {
+          external_overflow_pushes_.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      overflow_[band].Push(std::move(t));
+    }
     // Note: below we touch this after making w available to worker threads.
     // Strictly speaking, this can lead to a racy-use-after-free. Consider that
     // Schedule is called from a thread that is neither main thread nor a worker
@@ -128,11 +196,11 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     // completes overall computations, which in turn leads to destruction of
     // this. We expect that such scenario is prevented by program, that is,
     // this is kept alive while any threads can potentially be in Schedule.
-    if (!t.f) {
-      ec_.Notify(false);
-    } else {
-      env_.ExecuteTask(t);  // Push failed, execute directly.
+    // High priority tasks can be run by any thread, reserved or not.
+    if (band == kHighPriority && num_reserved_ > 0) {
+      reserved_ec_.Notify(false);
     }
+    ec_.Notify(false);
   }
 
   void Cancel() EIGEN_OVERRIDE {
@@ -148,6 +216,7 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
 
     // Wake up the threads without work to let them exit on their own.
     ec_.Notify(true);
+    reserved_ec_.Notify(true);
   }
 
   int NumThreads() const EIGEN_FINAL { return num_threads_; }
@@ -161,6 +230,28 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     }
   }
 
+  // Returns a snapshot of the pool statistics. It can be taken at any time,
+  // including while the pool is running tasks. The statistics are empty unless
+  // the pool was instantiated with CollectStats.
+  ThreadPoolStats Stats() const {
+    ThreadPoolStats stats;
+    if (!CollectStats) return stats;
+    stats.enabled = true;
+    stats.threads.resize(num_threads_);
+    for (int i = 0; i < num_threads_; i++) {
+      worker_stats_[i].Snapshot(&stats.threads[i]);
+      for (int band = 0; band < kNumPriorities; band++) {
+        stats.threads[i].queue_size += thread_data_[i].queue[band].Size();
+      }
+    }
+    stats.external_overflow_pushes =
+        external_overflow_pushes_.load(std::memory_order_relaxed);
+    for (int band = 0; band < kNumPriorities; band++) {
+      stats.overflow_queue_size += overflow_[band].Size();
+    }
+    return stats;
+  }
+
  private:
   // Create a single atomic<int> that encodes start and limit information for
   // each thread.
@@ -170,6 +261,7 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
   // this encode/decode logic for maintaining their own thread-safe copies of
   // scheduling and steal domain(s).
   static const int kMaxPartitionBits = 16;
+  static const int kNumPriorities = 2;
   static const int kMaxThreads = 1 << kMaxPartitionBits;
 
   inline unsigned EncodePartition(unsigned start, unsigned limit) {
@@ -213,6 +305,25 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
   }
 
   typedef typename Environment::EnvThread Thread;
+  typedef internal::ThreadPoolWorkerStats<CollectStats> WorkerStats;
+
+  // Wraps the scheduled functions to measure their queue wait time when the
+  // statistics are enabled.
+  struct TimedFunction {
+    TimedFunction(std::function<void()> fn, uint64_t time, ThreadPoolTempl* owner)
+        : f(std::move(fn)), scheduled(time), pool(owner) {}
+    void operator()() {
+      const PerThread* pt = pool->GetPerThread();
+      if (pt->pool == pool) {
+        pool->worker_stats_[pt->thread_id].Record(ThreadPoolStats::kQueueWaitTime,
+                                                  WorkerStats::Now() - scheduled);
+      }
+      f();
+    }
+    std::function<void()> f;
+    uint64_t scheduled;
+    ThreadPoolTempl* pool;
+  };
 
   struct PerThread {
     constexpr PerThread() : pool(NULL), rand(0), thread_id(-1) {}
@@ -229,21 +340,31 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     constexpr ThreadData() : thread(), steal_partition(0), queue() {}
     std::unique_ptr<Thread> thread;
     std::atomic<unsigned> steal_partition;
-    Queue queue;
+    Queue queue[kNumPriorities];  // Indexed by Priority.
   };
 
   Environment env_;
   const int num_threads_;
+  const int num_reserved_;
   const bool allow_spinning_;
   MaxSizeVector<ThreadData> thread_data_;
   MaxSizeVector<MaxSizeVector<unsigned>> all_coprimes_;
   MaxSizeVector<EventCount::Waiter> waiters_;
+  MaxSizeVector<WorkerStats> worker_stats_;
   unsigned global_steal_partition_;
   std::atomic<unsigned> blocked_;
   std::atomic<bool> spinning_;
+  std::atomic<bool> reserved_spinning_;
+  // Upper bound on the number of queued high priority tasks, lets the workers
+  // skip looking for them when there are none.
+  std::atomic<int> high_priority_pending_;
   std::atomic<bool> done_;
   std::atomic<bool> cancelled_;
-  EventCount ec_;
+  std::atomic<uint64_t> external_overflow_pushes_;
+  // Tasks that did not fit in the queue they were pushed to.
+  Overflow overflow_[kNumPriorities];
+  EventCount ec_;           // Waited on by the threads running all the tasks.
+  EventCount reserved_ec_;  // Waited on by the reserved threads.
 #ifndef EIGEN_THREAD_LOCAL
   std::unique_ptr<Barrier> init_barrier_;
   std::mutex per_thread_map_mutex_;  // Protects per_thread_map_.
@@ -266,8 +387,10 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     pt->pool = this;
     pt->rand = GlobalThreadIdHash();
     pt->thread_id = thread_id;
-    Queue& q = thread_data_[thread_id].queue;
+    ThreadData& td = thread_data_[thread_id];
     EventCount::Waiter* waiter = &waiters_[thread_id];
+    WorkerStats& stats = worker_stats_[thread_id];
+    const bool reserved = IsReserved(thread_id);
     // TODO(dvyukov,rmlarsen): The time spent in NonEmptyQueueIndex() is
     // proportional to num_threads_ and we assume that new work is scheduled at
     // a constant rate, so we set spin_count to 5000 / num_threads_. The
@@ -282,11 +405,16 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
       // counter-productive for the types of I/O workloads the single thread
       // pools tend to be used for.
       while (!cancelled_) {
-        Task t = q.PopFront();
-        for (int i = 0; i < spin_count && !t.f; i++) {
-          if (!cancelled_.load(std::memory_order_relaxed)) {
-            t = q.PopFront();
+        Task t = PopLocal(td, stats);
+        if (!t.f && spin_count > 0) {
+          stats.Add(ThreadPoolStats::kSpins);
+          int i = 0;
+          for (; i < spin_count && !t.f; i++) {
+            if (!cancelled_.load(std::memory_order_relaxed)) {
+              t = PopLocal(td, stats);
+            }
           }
+          stats.Add(ThreadPoolStats::kSpinIterations, i);
         }
         if (!t.f) {
           if (!WaitForWork(waiter, &t)) {
@@ -294,46 +422,135 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
           }
         }
         if (t.f) {
-          env_.ExecuteTask(t);
+          ExecuteTask(stats, t);
         }
       }
     } else {
+      // The reserved threads spin on their own, so that they do not take the
+      // place of a thread running all the tasks.
+      std::atomic<bool>& spinning = reserved ? reserved_spinning_ : spinning_;
       while (!cancelled_) {
-        Task t = q.PopFront();
+        Task t = FindTask(td, reserved, stats);
         if (!t.f) {
-          t = LocalSteal();
-          if (!t.f) {
-            t = GlobalSteal();
-            if (!t.f) {
-              // Leave one thread spinning. This reduces latency.
-              if (allow_spinning_ && !spinning_ && !spinning_.exchange(true)) {
-                for (int i = 0; i < spin_count && !t.f; i++) {
-                  if (!cancelled_.load(std::memory_order_relaxed)) {
-                    t = GlobalSteal();
-                  } else {
-                    return;
-                  }
-                }
-                spinning_ = false;
-              }
-              if (!t.f) {
-                if (!WaitForWork(waiter, &t)) {
-                  return;
-                }
+          // Leave one thread spinning. This reduces latency.
+          if (allow_spinning_ && !spinning && !spinning.exchange(true)) {
+            stats.Add(ThreadPoolStats::kSpins);
+            int i = 0;
+            for (; i < spin_count && !t.f; i++) {
+              if (!cancelled_.load(std::memory_order_relaxed)) {
+                t = FindTask(td, reserved, stats);
+              } else {
+                return;
               }
             }
+            stats.Add(ThreadPoolStats::kSpinIterations, i);
+            spinning = false;
+          }
+          if (!t.f) {
+            if (!WaitForWork(waiter, &t)) {
+              return;
+            }
           }
         }
         if (t.f) {
-          env_.ExecuteTask(t);
+          ExecuteTask(stats, t);
         }
       }
     }
   }
 
+  // Runs a task taken from the queues, timing it if the statistics are
+  // enabled.
+  EIGEN_STRONG_INLINE void ExecuteTask(WorkerStats& stats, Task& t) {
+    if (CollectStats) {
+      const uint64_t start = WorkerStats::Now();
+      env_.ExecuteTask(t);
+      stats.Record(ThreadPoolStats::kTaskRunTime, WorkerStats::Now() - start);
+      stats.Add(ThreadPoolStats::kTasksExecuted);
+    } else {
+      env_.ExecuteTask(t);
+    }
+  }
+
+  bool IsReserved(int thread_id) const {
+    return thread_id >= num_threads_ - num_reserved_;
+  }
+
+  // Number of threads, from the first one, running normal priority tasks.
+  int NumUnreserved() const { return num_threads_ - num_reserved_; }
+
+  // Skips the high priority band when no such task is queued.
+  bool SkipBand(int band) const {
+    return band == kHighPriority &&
+           high_priority_pending_.load(std::memory_order_relaxed) <= 0;
+  }
+
+  // Must be called for every task taken from the queues of a band.
+  void CountTaken(int band) {
+    if (band == kHighPriority) {
+      high_priority_pending_.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Looks for a task in the priority bands run by the thread, high priority
+  // first. In each band, looks in the thread's queue, then in its steal
+  // partition, in the overflow queue and in the whole pool.
+  Task FindTask(ThreadData& td, bool reserved, WorkerStats& stats) {
+    const int num_bands = reserved ? 1 : kNumPriorities;
+    for (int band = 0; band < num_bands; band++) {
+      if (SkipBand(band)) continue;
+      Task t = td.queue[band].PopFront();
+      if (t.f) {
+        stats.Add(ThreadPoolStats::kLocalPops);
+      } else {
+        t = LocalSteal(band);
+        if (t.f) {
+          stats.Add(ThreadPoolStats::kLocalSteals);
+        } else {
+          t = PopOverflow(band, stats);
+          if (t.f) return t;
+          t = GlobalSteal(band);
+          if (t.f) stats.Add(ThreadPoolStats::kGlobalSteals);
+        }
+      }
+      if (t.f) {
+        CountTaken(band);
+        return t;
+      }
+    }
+    return Task();
+  }
+
+  // Takes a task from the queues of a single thread pool, high priority
+  // first.
+  Task PopLocal(ThreadData& td, WorkerStats& stats) {
+    for (int band = 0; band < kNumPriorities; band++) {
+      if (SkipBand(band)) continue;
+      Task t = td.queue[band].PopFront();
+      if (t.f) {
+        stats.Add(ThreadPoolStats::kLocalPops);
+        CountTaken(band);
+        return t;
+      }
+      t = PopOverflow(band, stats);
+      if (t.f) return t;
+    }
+    return Task();
+  }
+
+  // Takes a task from the overflow queue of a band.
+  Task PopOverflow(int band, WorkerStats& stats) {
+    Task t = overflow_[band].Pop();
+    if (t.f) {
+      stats.Add(ThreadPoolStats::kOverflowPops);
+      CountTaken(band);
+    }
+    return t;
+  }
+
   // Steal tries to steal work from other worker threads in the range [start,
   // limit) in best-effort manner.
-  Task Steal(unsigned start, unsigned limit) {
+  Task Steal(unsigned start, unsigned limit, int band) {
     PerThread* pt = GetPerThread();
     const size_t size = limit - start;
     unsigned r = Rand(&pt->rand);
@@ -346,7 +563,7 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
 
     for (unsigned i = 0; i < size; i++) {
       eigen_plain_assert(start + victim < limit);
-      Task t = thread_data_[start + victim].queue.PopBack();
+      Task t = thread_data_[start + victim].queue[band].PopBack();
       if (t.f) {
         return t;
       }
@@ -359,7 +576,7 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
   }
 
   // Steals work within threads belonging to the partition.
-  Task LocalSteal() {
+  Task LocalSteal(int band) {
     PerThread* pt = GetPerThread();
     unsigned partition = GetStealPartition(pt->thread_id);
     // If thread steal partition is the same as global partition, there is no
@@ -369,12 +586,13 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     DecodePartition(partition, &start, &limit);
     AssertBounds(start, limit);
 
-    return Steal(start, limit);
+    return Steal(start, limit, band);
   }
 
-  // Steals work from any other thread in the pool.
-  Task GlobalSteal() {
-    return Steal(0, num_threads_);
+  // Steals work from any other thread in the pool. Normal priority tasks are
+  // only queued on the threads that are not reserved.
+  Task GlobalSteal(int band) {
+    return Steal(0, band == kHighPriority ? num_threads_ : NumUnreserved(), band);
   }
 
 
@@ -383,19 +601,39 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
   // (in such case t.f != nullptr on return).
   bool WaitForWork(EventCount::Waiter* waiter, Task* t) {
     eigen_plain_assert(!t->f);
+    const int thread_id = static_cast<int>(waiter - &waiters_[0]);
+    const bool reserved = IsReserved(thread_id);
+    // The reserved threads wait apart, so that the notifications of normal
+    // priority tasks only wake threads able to run them.
+    EventCount& ec = reserved ? reserved_ec_ : ec_;
     // We already did best-effort emptiness check in Steal, so prepare for
     // blocking.
-    ec_.Prewait();
-    // Now do a reliable emptiness check.
-    int victim = NonEmptyQueueIndex();
-    if (victim != -1) {
-      ec_.CancelWait();
-      if (cancelled_) {
-        return false;
-      } else {
-        *t = thread_data_[victim].queue.PopBack();
+    ec.Prewait();
+    // Now do a reliable emptiness check of the bands run by this thread.
+    const int num_bands = reserved ? 1 : kNumPriorities;
+    for (int band = 0; band < num_bands; band++) {
+      if (!overflow_[band].Empty()) {
+        ec.CancelWait();
+        if (cancelled_) {
+          return false;
+        }
+        *t = PopOverflow(band, worker_stats_[thread_id]);
         return true;
       }
+      int victim = NonEmptyQueueIndex(band);
+      if (victim != -1) {
+        ec.CancelWait();
+        if (cancelled_) {
+          return false;
+        } else {
+          *t = thread_data_[victim].queue[band].PopBack();
+          if (t->f) {
+            worker_stats_[thread_id].Add(ThreadPoolStats::kWaitSteals);
+            CountTaken(band);
+          }
+          return true;
+        }
+      }
     }
     // Number of blocked threads is used as termination condition.
     // If we are shutting down and all worker threads blocked without work,
@@ -403,32 +641,36 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     blocked_++;
     // TODO is blocked_ required to be unsigned?
     if (done_ && blocked_ == static_cast<unsigned>(num_threads_)) {
-      ec_.CancelWait();
+      ec.CancelWait();
       // Almost done, but need to re-check queues.
       // Consider that all queues are empty and all worker threads are preempted
       // right after incrementing blocked_ above. Now a free-standing thread
       // submits work and calls destructor (which sets done_). If we don't
       // re-check queues, we will exit leaving the work unexecuted.
-      if (NonEmptyQueueIndex() != -1) {
-        // Note: we must not pop from queues before we decrement blocked_,
-        // otherwise the following scenario is possible. Consider that instead
-        // of checking for emptiness we popped the only element from queues.
-        // Now other worker threads can start exiting, which is bad if the
-        // work item submits other work. So we just check emptiness here,
-        // which ensures that all worker threads exit at the same time.
-        blocked_--;
-        return true;
+      for (int band = 0; band < kNumPriorities; band++) {
+        if (NonEmptyQueueIndex(band) != -1 || !overflow_[band].Empty()) {
+          // Note: we must not pop from queues before we decrement blocked_,
+          // otherwise the following scenario is possible. Consider that instead
+          // of checking for emptiness we popped the only element from queues.
+          // Now other worker threads can start exiting, which is bad if the
+          // work item submits other work. So we just check emptiness here,
+          // which ensures that all worker threads exit at the same time.
+          blocked_--;
+          return true;
+        }
       }
       // Reached stable termination state.
       ec_.Notify(true);
+      reserved_ec_.Notify(true);
       return false;
     }
-    ec_.CommitWait(waiter);
+    worker_stats_[thread_id].Add(ThreadPoolStats::kParks);
+    ec.CommitWait(waiter);
     blocked_--;
     return true;
   }
 
-  int NonEmptyQueueIndex() {
+  int NonEmptyQueueIndex(int band) {
     PerThread* pt = GetPerThread();
     // We intentionally design NonEmptyQueueIndex to steal work from
     // anywhere in the queue so threads don't block in WaitForWork() forever
@@ -438,7 +680,7 @@ class ThreadPoolTempl : public Eigen::ThreadPoolInterface {
     unsigned inc = all_coprimes_[size - 1][r % all_coprimes_[size - 1].size()];
     unsigned victim = r % size;
     for (unsigned i = 0; i < size; i++) {
-      if (!thread_data_[victim].queue.Empty()) {
+      if (!thread_data_[victim].queue[band].Empty()) {
         return victim;
       }
       victim += inc;
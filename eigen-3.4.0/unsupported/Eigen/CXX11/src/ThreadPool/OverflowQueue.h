@@ -0,0 +1,188 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_CXX11_THREADPOOL_OVERFLOW_QUEUE_H
+#define EIGEN_CXX11_THREADPOOL_OVERFLOW_QUEUE_H
+
+namespace Eigen {
+
+// OverflowQueue is an unbounded, non-blocking, multi-producer multi-consumer
+// queue of Work items. ThreadPoolTempl pushes to it the tasks that do not fit
+// in a full RunQueue, so that scheduling never executes them inline.
+//
+// Algorithm outline:
+// The queue is a singly linked list of segments, each one a bounded MPMC ring
+// buffer where every cell carries a sequence number telling whether it is
+// ready to be written or read at the current lap (D. Vyukov's bounded MPMC
+// queue). Push tries the segments in list order and, when all of them are
+// full, appends a new segment twice as large as the last one. Pop tries the
+// segments in list order as well. Segments are never unlinked: once drained,
+// they are reused by the next pushes, so no memory reclamation scheme is
+// needed and the memory stays bounded by the peak number of queued items.
+// The list is short since capacities grow geometrically.
+//
+// Items pushed to different segments are not ordered with respect to each
+// other, and an item can be overtaken by a later one when it is the only item
+// of its segment. The queue is roughly, not strictly, FIFO.
+template <typename Work, unsigned kInitialSize>
+class OverflowQueue {
+ public:
+  OverflowQueue() : head_(NULL), size_(0) {
+    // require power-of-two for fast masking
+    eigen_plain_assert((kInitialSize & (kInitialSize - 1)) == 0);
+    eigen_plain_assert(kInitialSize >= 2);
+  }
+
+  ~OverflowQueue() {
+    Segment* s = head_.load(std::memory_order_relaxed);
+    while (s) {
+      Segment* next = s->next.load(std::memory_order_relaxed);
+      delete s;
+      s = next;
+    }
+  }
+
+  // Push inserts w at the end of the queue. It always succeeds, allocating a
+  // new segment when all the existing ones are full.
+  void Push(Work w) {
+    std::atomic<Segment*>* link = &head_;
+    unsigned capacity = kInitialSize;
+    for (;;) {
+      Segment* s = link->load(std::memory_order_acquire);
+      if (s == NULL) {
+        Segment* fresh = new Segment(capacity);
+        if (link->compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) {
+          s = fresh;
+        } else {
+          delete fresh;
+        }
+      }
+      if (s->Push(w)) break;
+      link = &s->next;
+      capacity = 2 * s->capacity;
+    }
+    // Increment after publishing the item, so that a consumer seeing a non
+    // zero size (after EventCount::Prewait) finds the item.
+    size_.fetch_add(1, std::memory_order_seq_cst);
+  }
+
+  // Pop removes and returns the oldest item of the first non-empty segment.
+  // If the queue is empty returns default-constructed Work.
+  Work Pop() {
+    Work w = Work();
+    if (size_.load(std::memory_order_relaxed) <= 0) return w;
+    for (Segment* s = head_.load(std::memory_order_acquire); s != NULL;
+         s = s->next.load(std::memory_order_acquire)) {
+      if (s->Pop(&w)) {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        break;
+      }
+    }
+    return w;
+  }
+
+  // Size returns the current number of items in the queue. It can be called
+  // by any thread, and the result is approximate when the queue is being
+  // modified concurrently.
+  unsigned Size() const {
+    const int64_t size = size_.load(std::memory_order_relaxed);
+    return size > 0 ? static_cast<unsigned>(size) : 0;
+  }
+
+  // Empty tests whether the queue is empty. It is a reliable check when
+  // ordered after EventCount::Prewait, as the size is updated with sequential
+  // consistency once the item is published.
+  bool Empty() const { return size_.load(std::memory_order_seq_cst) <= 0; }
+
+  // Delete all the elements from the queue.
+  void Flush() {
+    while (!Empty()) {
+      Pop();
+    }
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    Work w;
+  };
+
+  struct Segment {
+    explicit Segment(unsigned size)
+        : capacity(size), mask(size - 1), cells(size), next(NULL) {
+      cells.resize(size);
+      for (unsigned i = 0; i < size; i++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+      enqueue_pos.store(0, std::memory_order_relaxed);
+      dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    // Moves from w only on success.
+    bool Push(Work& w) {
+      size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+      Cell* cell;
+      for (;;) {
+        cell = &cells[pos & mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+          if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+          return false;  // full
+        } else {
+          pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+      cell->w = std::move(w);
+      cell->sequence.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool Pop(Work* w) {
+      size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+      Cell* cell;
+      for (;;) {
+        cell = &cells[pos & mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+          if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+          return false;  // empty
+        } else {
+          pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+      }
+      *w = std::move(cell->w);
+      cell->w = Work();
+      cell->sequence.store(pos + mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    const unsigned capacity;
+    const size_t mask;
+    MaxSizeVector<Cell> cells;
+    std::atomic<Segment*> next;
+    // Producers and consumers update different positions, keep them on
+    // different cache lines.
+    char pad0_[128];
+    std::atomic<size_t> enqueue_pos;
+    char pad1_[128];
+    std::atomic<size_t> dequeue_pos;
+    char pad2_[128];
+  };
+
+  std::atomic<Segment*> head_;
+  std::atomic<int64_t> size_;
+
+  OverflowQueue(const OverflowQueue&) = delete;
+  void operator=(const OverflowQueue&) = delete;
+};
+
+}  // namespace Eigen
+
+#endif  // EIGEN_CXX11_THREADPOOL_OVERFLOW_QUEUE_H
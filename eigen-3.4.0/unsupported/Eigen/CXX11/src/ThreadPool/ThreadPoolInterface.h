@@ -28,6 +28,28 @@ class ThreadPoolInterface {
     Schedule(fn);
   }
 
+  // Priority bands of the submitted closures. Pools supporting them run the
+  // pending high priority closures before the normal priority ones.
+  enum Priority {
+    kHighPriority = 0,
+    kNormalPriority = 1
+  };
+
+  // Submits a closure with the given priority. Schedule and ScheduleWithHint
+  // submit normal priority closures.
+  virtual void ScheduleWithPriority(std::function<void()> fn,
+                                    Priority /*priority*/) {
+    // Defer to Schedule for the sub-classes without priority support.
+    Schedule(std::move(fn));
+  }
+
+  // Submits a closure with the given priority to be run by threads in the
+  // range [start, end) in the pool.
+  virtual void ScheduleWithHintAndPriority(std::function<void()> fn, int start,
+                                           int end, Priority /*priority*/) {
+    ScheduleWithHint(std::move(fn), start, end);
+  }
+
   // If implemented, stop processing the closures that have been enqueued.
   // Currently running closures may still be processed.
   // If not implemented, does nothing.
@@ -0,0 +1,220 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_CXX11_THREADPOOL_THREAD_POOL_STATS_H
+#define EIGEN_CXX11_THREADPOOL_THREAD_POOL_STATS_H
+
+namespace Eigen {
+
+// Snapshot of the runtime statistics of a ThreadPoolTempl, returned by
+// ThreadPoolTempl::Stats().
+//
+// The statistics are only collected by the pools whose CollectStats template
+// argument is true. Otherwise `enabled` is false and all the values are zero,
+// and the pool does not pay anything for them.
+//
+// Each worker thread updates its own counters with relaxed atomic stores, so a
+// snapshot taken while the pool is running is not a consistent cut across
+// threads, but every value is one that was actually reached.
+struct ThreadPoolStats {
+  enum Counter {
+    kTasksExecuted = 0,  // tasks taken from the queues and run by the worker
+    kLocalPops,          // tasks popped from the worker's own queue
+    kLocalSteals,        // tasks stolen inside the worker's steal partition
+    kGlobalSteals,       // tasks stolen anywhere in the pool, spinning included
+    kWaitSteals,         // tasks found by the last check before parking
+    kSpins,              // spinning phases started
+    kSpinIterations,     // steal attempts made while spinning
+    kOverflowPops,       // tasks taken from the overflow queue
+    kParks,              // times the worker blocked on the EventCount
+    kOverflowPushes,     // tasks the worker scheduled to the overflow queue
+                         // because its own queue was full
+    kNumCounters
+  };
+
+  enum HistogramKind {
+    kTaskRunTime = 0,  // time spent executing each task
+    kQueueWaitTime,    // time between scheduling a task and starting it
+    kNumHistograms
+  };
+
+  // Histogram of durations in nanoseconds, with power of two buckets: bucket 0
+  // counts the zero durations and bucket b > 0 the durations in
+  // [2^(b-1), 2^b). The last bucket also counts all the longer durations.
+  struct Histogram {
+    static const int kNumBuckets = 40;
+    uint64_t buckets[kNumBuckets];
+
+    Histogram() { std::fill(buckets, buckets + kNumBuckets, uint64_t(0)); }
+
+    static int Bucket(uint64_t ns) {
+      int b = 0;
+      while (ns != 0 && b < kNumBuckets - 1) {
+        ns >>= 1;
+        ++b;
+      }
+      return b;
+    }
+
+    // Upper bound, in nanoseconds, of the durations counted in bucket b.
+    static uint64_t BucketLimit(int b) { return b == 0 ? 0 : (uint64_t(1) << b) - 1; }
+
+    uint64_t Count() const {
+      uint64_t n = 0;
+      for (int b = 0; b < kNumBuckets; ++b) n += buckets[b];
+      return n;
+    }
+
+    // Upper bound of the bucket holding the q-quantile, 0 <= q <= 1.
+    uint64_t Percentile(double q) const {
+      const uint64_t n = Count();
+      if (n == 0) return 0;
+      const uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(n)));
+      uint64_t seen = 0;
+      for (int b = 0; b < kNumBuckets; ++b) {
+        seen += buckets[b];
+        if (seen >= rank && seen > 0) return BucketLimit(b);
+      }
+      return BucketLimit(kNumBuckets - 1);
+    }
+  };
+
+  struct Thread {
+    uint64_t counters[kNumCounters];
+    Histogram histograms[kNumHistograms];
+    unsigned queue_size;      // tasks in the worker's queue at snapshot time
+    unsigned max_queue_size;  // largest queue size seen after a push
+
+    Thread() : queue_size(0), max_queue_size(0) {
+      std::fill(counters, counters + kNumCounters, uint64_t(0));
+    }
+  };
+
+  ThreadPoolStats() : enabled(false), external_overflow_pushes(0), overflow_queue_size(0) {}
+
+  // Sum of the statistics of all the worker threads. The queue sizes are
+  // summed, the maximum queue sizes are maxed.
+  Thread Total() const {
+    Thread total;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      const Thread& t = threads[i];
+      for (int c = 0; c < kNumCounters; ++c) total.counters[c] += t.counters[c];
+      for (int h = 0; h < kNumHistograms; ++h)
+        for (int b = 0; b < Histogram::kNumBuckets; ++b)
+          total.histograms[h].buckets[b] += t.histograms[h].buckets[b];
+      total.queue_size += t.queue_size;
+      total.max_queue_size = (std::max)(total.max_queue_size, t.max_queue_size);
+    }
+    return total;
+  }
+
+  // Statistics of the activity between the snapshot `earlier` and this one:
+  // counters and histograms are subtracted, queue sizes are kept.
+  ThreadPoolStats Since(const ThreadPoolStats& earlier) const {
+    eigen_plain_assert(earlier.threads.size() == threads.size());
+    ThreadPoolStats delta = *this;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      Thread& t = delta.threads[i];
+      const Thread& e = earlier.threads[i];
+      for (int c = 0; c < kNumCounters; ++c) t.counters[c] -= e.counters[c];
+      for (int h = 0; h < kNumHistograms; ++h)
+        for (int b = 0; b < Histogram::kNumBuckets; ++b)
+          t.histograms[h].buckets[b] -= e.histograms[h].buckets[b];
+    }
+    delta.external_overflow_pushes -= earlier.external_overflow_pushes;
+    return delta;
+  }
+
+  static const char* CounterName(int c) {
+    static const char* const names[kNumCounters] = {
+        "tasks_executed",  "local_pops",     "local_steals",
+        "global_steals",   "wait_steals",    "spins",
+        "spin_iterations", "overflow_pops",  "parks",
+        "overflow_pushes"};
+    return c >= 0 && c < kNumCounters ? names[c] : "";
+  }
+
+  bool enabled;
+  std::vector<Thread> threads;
+  // Tasks scheduled to the overflow queue by threads outside the pool because
+  // the queue they picked was full.
+  uint64_t external_overflow_pushes;
+  // Tasks in the overflow queue at snapshot time.
+  unsigned overflow_queue_size;
+};
+
+namespace internal {
+
+// Statistics of one worker thread. All the updates except UpdateMaxQueueSize
+// come from the worker itself, so they are plain relaxed load/store pairs
+// rather than read-modify-write operations.
+template <bool Enabled>
+class ThreadPoolWorkerStats {
+ public:
+  ThreadPoolWorkerStats() : max_queue_size_(0) {
+    for (int c = 0; c < ThreadPoolStats::kNumCounters; ++c)
+      counters_[c].store(0, std::memory_order_relaxed);
+    for (int h = 0; h < ThreadPoolStats::kNumHistograms; ++h)
+      for (int b = 0; b < ThreadPoolStats::Histogram::kNumBuckets; ++b)
+        histograms_[h][b].store(0, std::memory_order_relaxed);
+  }
+
+  static uint64_t Now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  void Add(ThreadPoolStats::Counter c, uint64_t n = 1) {
+    counters_[c].store(counters_[c].load(std::memory_order_relaxed) + n,
+                       std::memory_order_relaxed);
+  }
+
+  void Record(ThreadPoolStats::HistogramKind h, uint64_t ns) {
+    std::atomic<uint64_t>& bucket = histograms_[h][ThreadPoolStats::Histogram::Bucket(ns)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  // Called by any thread pushing to the worker's queue.
+  void UpdateMaxQueueSize(unsigned size) {
+    unsigned current = max_queue_size_.load(std::memory_order_relaxed);
+    while (size > current &&
+           !max_queue_size_.compare_exchange_weak(current, size, std::memory_order_relaxed)) {
+    }
+  }
+
+  void Snapshot(ThreadPoolStats::Thread* t) const {
+    for (int c = 0; c < ThreadPoolStats::kNumCounters; ++c)
+      t->counters[c] = counters_[c].load(std::memory_order_relaxed);
+    for (int h = 0; h < ThreadPoolStats::kNumHistograms; ++h)
+      for (int b = 0; b < ThreadPoolStats::Histogram::kNumBuckets; ++b)
+        t->histograms[h].buckets[b] = histograms_[h][b].load(std::memory_order_relaxed);
+    t->max_queue_size = max_queue_size_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> counters_[ThreadPoolStats::kNumCounters];
+  std::atomic<uint64_t> histograms_[ThreadPoolStats::kNumHistograms][ThreadPoolStats::Histogram::kNumBuckets];
+  std::atomic<unsigned> max_queue_size_;
+  // Prevent false sharing with the next worker's counters.
+  char pad_[128];
+};
+
+template <>
+class ThreadPoolWorkerStats<false> {
+ public:
+  static uint64_t Now() { return 0; }
+  void Add(ThreadPoolStats::Counter, uint64_t = 1) {}
+  void Record(ThreadPoolStats::HistogramKind, uint64_t) {}
+  void UpdateMaxQueueSize(unsigned) {}
+  void Snapshot(ThreadPoolStats::Thread*) const {}
+};
+
+}  // namespace internal
+
+}  // namespace Eigen
+
+#endif  // EIGEN_CXX11_THREADPOOL_THREAD_POOL_STATS_H
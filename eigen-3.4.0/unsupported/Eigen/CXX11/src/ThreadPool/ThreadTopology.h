@@ -0,0 +1,336 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_CXX11_THREADPOOL_THREAD_TOPOLOGY_H
+#define EIGEN_CXX11_THREADPOOL_THREAD_TOPOLOGY_H
+
+namespace Eigen {
+
+// CpuTopology describes the logical CPUs of the machine: the physical core,
+// package (socket) and NUMA node of each one. On Linux it is read from sysfs,
+// elsewhere all the CPUs are reported on a single node.
+struct CpuTopology {
+  struct Cpu {
+    int id;       // Logical CPU number, as used by sched_setaffinity.
+    int core;     // Physical core id, unique within a package.
+    int package;  // Physical package (socket) id.
+    int node;     // NUMA node.
+  };
+
+  // Sorted by node, package, core and id.
+  std::vector<Cpu> cpus;
+
+  int NumNodes() const {
+    int n = 0;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+      if (i == 0 || cpus[i].node != cpus[i - 1].node) n++;
+    }
+    return n;
+  }
+
+  // Returns the topology of the CPUs the calling process is allowed to run
+  // on.
+  static CpuTopology Detect() {
+#if defined(__linux__)
+    CpuTopology topology = FromSysfs("/sys");
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (!topology.cpus.empty() &&
+        sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+      std::vector<Cpu> cpus;
+      for (size_t i = 0; i < topology.cpus.size(); ++i) {
+        const int id = topology.cpus[i].id;
+        if (id < CPU_SETSIZE && CPU_ISSET(id, &allowed)) {
+          cpus.push_back(topology.cpus[i]);
+        }
+      }
+      if (!cpus.empty()) topology.cpus.swap(cpus);
+    }
+    if (!topology.cpus.empty()) return topology;
+#endif
+    return Flat(static_cast<int>(std::thread::hardware_concurrency()));
+  }
+
+  // A single node of num_cpus CPUs, each one on its own core.
+  static CpuTopology Flat(int num_cpus) {
+    CpuTopology topology;
+    for (int i = 0; i < numext::maxi(num_cpus, 1); ++i) {
+      Cpu cpu = {i, i, 0, 0};
+      topology.cpus.push_back(cpu);
+    }
+    return topology;
+  }
+
+  // Reads the topology from a sysfs tree mounted at root: the online CPUs
+  // from devices/system/cpu/online, their core and package from
+  // devices/system/cpu/cpuN/topology, and their NUMA node from
+  // devices/system/node/nodeN/cpulist. Returns an empty topology when the CPU
+  // list cannot be read.
+  static CpuTopology FromSysfs(const std::string& root) {
+    CpuTopology topology;
+    const std::string cpu_dir = root + "/devices/system/cpu/";
+    const std::string node_dir = root + "/devices/system/node/";
+    std::vector<int> online;
+    if (!ParseCpuList(ReadLine(cpu_dir + "online"), &online)) return topology;
+
+    // The list is usually ascending, but nothing requires it.
+    std::vector<int> node_of(*std::max_element(online.begin(), online.end()) + 1, 0);
+    // Node ids are usually contiguous, but stop only after a long gap.
+    for (int node = 0, missing = 0; missing < 64; ++node) {
+      std::vector<int> node_cpus;
+      if (!ParseCpuList(ReadLine(node_dir + "node" + std::to_string(node) + "/cpulist"),
+                        &node_cpus)) {
+        missing++;
+        continue;
+      }
+      missing = 0;
+      for (size_t i = 0; i < node_cpus.size(); ++i) {
+        if (node_cpus[i] < static_cast<int>(node_of.size())) node_of[node_cpus[i]] = node;
+      }
+    }
+
+    for (size_t i = 0; i < online.size(); ++i) {
+      const int id = online[i];
+      const std::string dir = cpu_dir + "cpu" + std::to_string(id) + "/topology/";
+      Cpu cpu = {id, ReadInt(dir + "core_id", id), ReadInt(dir + "physical_package_id", 0),
+                 node_of[id]};
+      topology.cpus.push_back(cpu);
+    }
+    std::sort(topology.cpus.begin(), topology.cpus.end(), CpuLess());
+    return topology;
+  }
+
+  // Parses a sysfs CPU list such as "0-3,8,10-11".
+  static bool ParseCpuList(const std::string& list, std::vector<int>* cpus) {
+    cpus->clear();
+    const char* p = list.c_str();
+    while (*p) {
+      char* end;
+      const long first = std::strtol(p, &end, 10);
+      if (end == p || first < 0) return false;
+      long last = first;
+      p = end;
+      if (*p == '-') {
+        last = std::strtol(p + 1, &end, 10);
+        if (end == p + 1 || last < first) return false;
+        p = end;
+      }
+      for (long cpu = first; cpu <= last; ++cpu) cpus->push_back(static_cast<int>(cpu));
+      if (*p == ',') ++p;
+      else if (*p && *p != '\n') return false;
+      else break;
+    }
+    return !cpus->empty();
+  }
+
+  // Places num_threads threads on the CPUs: the nodes get a share of the
+  // threads proportional to their number of CPUs, the threads of a node are
+  // contiguous, and they use one CPU per physical core before the hyperthread
+  // siblings. Returns the index in cpus of the CPU of each thread, and in
+  // node_ranges (if not null) the range of threads [first, last) of each
+  // node.
+  std::vector<int> Placement(int num_threads,
+                             std::vector<std::pair<int, int>>* node_ranges = NULL) const {
+    std::vector<int> placement;
+    if (node_ranges) node_ranges->clear();
+    if (cpus.empty() || num_threads <= 0) return placement;
+
+    // CPU index ranges of the nodes.
+    std::vector<std::pair<int, int>> nodes;
+    for (int i = 0; i < static_cast<int>(cpus.size()); ++i) {
+      if (i == 0 || cpus[i].node != cpus[i - 1].node) nodes.push_back(std::make_pair(i, i));
+      nodes.back().second = i + 1;
+    }
+
+    // Largest remainder apportionment of the threads to the nodes.
+    const int total = static_cast<int>(cpus.size());
+    std::vector<int> share(nodes.size());
+    std::vector<std::pair<int, int>> remainders;
+    int assigned = 0;
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      const int size = nodes[n].second - nodes[n].first;
+      share[n] = static_cast<int>(static_cast<int64_t>(num_threads) * size / total);
+      assigned += share[n];
+      remainders.push_back(std::make_pair(
+          -static_cast<int>(static_cast<int64_t>(num_threads) * size % total), static_cast<int>(n)));
+    }
+    std::sort(remainders.begin(), remainders.end());
+    for (size_t r = 0; assigned < num_threads; r = (r + 1) % remainders.size(), ++assigned) {
+      share[remainders[r].second]++;
+    }
+
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      // First the first CPU of every core, then the siblings.
+      std::vector<int> order;
+      for (int pass = 0; pass < 2; ++pass) {
+        for (int i = nodes[n].first; i < nodes[n].second; ++i) {
+          const bool first_of_core = i == nodes[n].first || cpus[i].core != cpus[i - 1].core ||
+                                     cpus[i].package != cpus[i - 1].package;
+          if (first_of_core == (pass == 0)) order.push_back(i);
+        }
+      }
+      if (node_ranges && share[n] > 0) {
+        const int first = static_cast<int>(placement.size());
+        node_ranges->push_back(std::make_pair(first, first + share[n]));
+      }
+      for (int t = 0; t < share[n]; ++t) {
+        placement.push_back(order[t % order.size()]);
+      }
+    }
+    return placement;
+  }
+
+ private:
+  struct CpuLess {
+    bool operator()(const Cpu& a, const Cpu& b) const {
+      if (a.node != b.node) return a.node < b.node;
+      if (a.package != b.package) return a.package < b.package;
+      if (a.core != b.core) return a.core < b.core;
+      return a.id < b.id;
+    }
+  };
+
+  static std::string ReadLine(const std::string& path) {
+    std::ifstream in(path.c_str());
+    std::string line;
+    std::getline(in, line);
+    return line;
+  }
+
+  static int ReadInt(const std::string& path, int fallback) {
+    const std::string line = ReadLine(path);
+    char* end;
+    const long value = std::strtol(line.c_str(), &end, 10);
+    return end == line.c_str() ? fallback : static_cast<int>(value);
+  }
+};
+
+// TopologyThreadEnvironment is a thread environment for ThreadPoolTempl that
+// places the worker threads on the machine topology (see
+// CpuTopology::Placement) and pins them there, so that a thread and the memory
+// it first touches stay on the same NUMA node.
+struct TopologyThreadEnvironment {
+  typedef StlThreadEnvironment::Task Task;
+
+  enum Pinning {
+    kPinToCpu,   // Each thread runs on its own CPU.
+    kPinToNode,  // Each thread runs on any CPU of its NUMA node.
+    kNoPinning   // Threads are placed but not pinned.
+  };
+
+  class EnvThread {
+   public:
+    EnvThread(std::function<void()> f, std::vector<int> cpus)
+        : thr_([f, cpus]() {
+            PinCurrentThread(cpus);
+            f();
+          }) {}
+    ~EnvThread() { thr_.join(); }
+    // This function is called when the threadpool is cancelled.
+    void OnCancel() {}
+
+   private:
+    std::thread thr_;
+  };
+
+  explicit TopologyThreadEnvironment(int num_threads, Pinning pinning = kPinToCpu,
+                                     const CpuTopology& topology = CpuTopology::Detect())
+      : topology_(topology),
+        placement_(topology.Placement(num_threads, &node_ranges_)),
+        pinning_(pinning),
+        num_threads_(numext::maxi(num_threads, 0)),
+        next_thread_(0) {}
+
+  // The threads are created in the order of their id in the pool.
+  EnvThread* CreateThread(std::function<void()> f) {
+    const int thread_id = next_thread_++;
+    std::vector<int> cpus;
+    if (pinning_ != kNoPinning && !placement_.empty()) {
+      const CpuTopology::Cpu& cpu =
+          topology_.cpus[placement_[thread_id % placement_.size()]];
+      for (size_t i = 0; i < topology_.cpus.size(); ++i) {
+        const CpuTopology::Cpu& other = topology_.cpus[i];
+        if (pinning_ == kPinToCpu ? other.id == cpu.id : other.node == cpu.node) {
+          cpus.push_back(other.id);
+        }
+      }
+    }
+    return new EnvThread(std::move(f), std::move(cpus));
+  }
+  Task CreateTask(std::function<void()> f) { return Task{std::move(f)}; }
+  void ExecuteTask(const Task& t) { t.f(); }
+
+  // Steal partitions of the pool threads, one per NUMA node, for
+  // ThreadPoolTempl::SetStealPartitions. Without a topology, all the threads
+  // are in one partition.
+  std::vector<std::pair<unsigned, unsigned>> StealPartitions() const {
+    std::vector<std::pair<unsigned, unsigned>> partitions(
+        num_threads_, std::make_pair(0u, static_cast<unsigned>(num_threads_)));
+    for (size_t n = 0; n < node_ranges_.size(); ++n) {
+      for (int t = node_ranges_[n].first; t < node_ranges_[n].second; ++t) {
+        partitions[t] = std::make_pair(static_cast<unsigned>(node_ranges_[n].first),
+                                       static_cast<unsigned>(node_ranges_[n].second));
+      }
+    }
+    return partitions;
+  }
+
+  const CpuTopology& Topology() const { return topology_; }
+
+  // Index in Topology().cpus of the CPU of each thread.
+  const std::vector<int>& Placement() const { return placement_; }
+
+  // Restricts the calling thread to the given logical CPUs. Best effort: does
+  // nothing if the list is empty, if pinning is not supported or fails.
+  static void PinCurrentThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); ++i) {
+      if (cpus[i] < CPU_SETSIZE) CPU_SET(cpus[i], &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    EIGEN_UNUSED_VARIABLE(cpus);
+#endif
+  }
+
+ private:
+  CpuTopology topology_;
+  std::vector<std::pair<int, int>> node_ranges_;
+  std::vector<int> placement_;
+  Pinning pinning_;
+  int num_threads_;
+  int next_thread_;
+};
+
+// TopologyThreadPool is a non-blocking thread pool whose threads are pinned
+// following the machine topology, with one steal partition per NUMA node so
+// that idle threads steal on their own node before stealing remotely.
+//
+// Combine it with a ThreadPoolDevice using a FirstTouchAllocator so that the
+// per-thread buffers of the tensor contractions are allocated on the node of
+// the thread using them.
+class TopologyThreadPool : public ThreadPoolTempl<TopologyThreadEnvironment> {
+ public:
+  explicit TopologyThreadPool(int num_threads, bool allow_spinning = true,
+                              TopologyThreadEnvironment::Pinning pinning =
+                                  TopologyThreadEnvironment::kPinToCpu)
+      : TopologyThreadPool(num_threads, allow_spinning,
+                           TopologyThreadEnvironment(num_threads, pinning)) {}
+
+  TopologyThreadPool(int num_threads, bool allow_spinning,
+                     const TopologyThreadEnvironment& env)
+      : ThreadPoolTempl<TopologyThreadEnvironment>(num_threads, allow_spinning, env) {
+    if (num_threads > 0) SetStealPartitions(env.StealPartitions());
+  }
+};
+
+}  // namespace Eigen
+
+#endif  // EIGEN_CXX11_THREADPOOL_THREAD_TOPOLOGY_H
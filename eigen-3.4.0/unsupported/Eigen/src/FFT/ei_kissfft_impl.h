@@ -25,6 +25,25 @@ struct kiss_cpx_fft
   std::vector<Complex> m_scratchBuf;
   bool m_inverse;
 
+  typedef typename packet_traits<Complex>::type ComplexPacket;
+  enum {
+    ComplexPacketSize = unpacket_traits<ComplexPacket>::size,
+    Vectorizable = packet_traits<Complex>::Vectorizable && ComplexPacketSize > 1
+  };
+
+  // Reuses the twiddles and factorization of the plan for the opposite
+  // direction: its twiddles are the complex conjugates of ours.
+  inline void make_conjugate(const kiss_cpx_fft & other)
+  {
+    m_inverse = !other.m_inverse;
+    m_twiddles.resize(other.m_twiddles.size());
+    for (size_t i=0;i<m_twiddles.size();++i)
+      m_twiddles[i] = numext::conj(other.m_twiddles[i]);
+    m_stageRadix = other.m_stageRadix;
+    m_stageRemainder = other.m_stageRemainder;
+    m_scratchBuf.resize(other.m_scratchBuf.size());
+  }
+
   inline void make_twiddles(int nfft, bool inverse)
   {
     using numext::sin;
@@ -136,12 +155,46 @@ struct kiss_cpx_fft
       }
     }
 
+  // Vectorized radix-4 butterfly over the first columns of a stage, one
+  // packet of columns at a time. Returns the number of columns processed.
+  inline
+    size_t bfly4_packets( Complex * Fout, const size_t fstride, const size_t m, true_type)
+    {
+      const Complex * tw = &m_twiddles[0];
+      const Index tw_stride = static_cast<Index>(fstride);
+      const size_t vectorized_size = (m / ComplexPacketSize) * ComplexPacketSize;
+      for (size_t k=0;k<vectorized_size;k+=ComplexPacketSize) {
+        ComplexPacket s0 = pmul(ploadu<ComplexPacket>(Fout+k+m), pgather<Complex,ComplexPacket>(tw+k*fstride, tw_stride));
+        ComplexPacket s1 = pmul(ploadu<ComplexPacket>(Fout+k+2*m), pgather<Complex,ComplexPacket>(tw+k*fstride*2, tw_stride*2));
+        ComplexPacket s2 = pmul(ploadu<ComplexPacket>(Fout+k+3*m), pgather<Complex,ComplexPacket>(tw+k*fstride*3, tw_stride*3));
+        ComplexPacket f0 = ploadu<ComplexPacket>(Fout+k);
+        ComplexPacket s5 = psub(f0, s1);
+        f0 = padd(f0, s1);
+        ComplexPacket s3 = padd(s0, s2);
+        ComplexPacket s4 = psub(s0, s2);
+        // multiply by -i (forward) or +i (inverse)
+        s4 = m_inverse ? pcplxflip(pconj(s4)) : pconj(pcplxflip(s4));
+
+        pstoreu(Fout+k+2*m, psub(f0, s3));
+        pstoreu(Fout+k, padd(f0, s3));
+        pstoreu(Fout+k+m, padd(s5, s4));
+        pstoreu(Fout+k+3*m, psub(s5, s4));
+      }
+      return vectorized_size;
+    }
+
+  inline
+    size_t bfly4_packets( Complex *, const size_t, const size_t, false_type)
+    {
+      return 0;
+    }
+
   inline
     void bfly4( Complex * Fout, const size_t fstride, const size_t m)
     {
       Complex scratch[6];
       int negative_if_inverse = m_inverse * -2 +1;
-      for (size_t k=0;k<m;++k) {
+      for (size_t k=bfly4_packets(Fout,fstride,m,bool_constant<Vectorizable>());k<m;++k) {
         scratch[0] = Fout[k+m] * m_twiddles[k*fstride];
         scratch[1] = Fout[k+2*m] * m_twiddles[k*fstride*2];
         scratch[2] = Fout[k+3*m] * m_twiddles[k*fstride*3];
@@ -310,22 +363,18 @@ struct kissfft_impl
       get_plan(nfft,false).work(0, dst, src, 1,1);
     }
 
+  // 2D forward FFT of a row-major n0 x n1 array (same layout as fftw)
   inline
     void fwd2( Complex * dst,const Complex *src,int n0,int n1)
     {
-        EIGEN_UNUSED_VARIABLE(dst);
-        EIGEN_UNUSED_VARIABLE(src);
-        EIGEN_UNUSED_VARIABLE(n0);
-        EIGEN_UNUSED_VARIABLE(n1);
+      work2(dst,src,n0,n1,false);
     }
 
+  // 2D inverse FFT, unscaled
   inline
     void inv2( Complex * dst,const Complex *src,int n0,int n1)
     {
-        EIGEN_UNUSED_VARIABLE(dst);
-        EIGEN_UNUSED_VARIABLE(src);
-        EIGEN_UNUSED_VARIABLE(n0);
-        EIGEN_UNUSED_VARIABLE(n1);
+      work2(dst,src,n0,n1,true);
     }
 
   // real-to-complex forward FFT
@@ -419,15 +468,36 @@ struct kissfft_impl
   inline
     PlanData & get_plan(int nfft, bool inverse)
     {
-      // TODO look for PlanKey(nfft, ! inverse) and conjugate the twiddles
       PlanData & pd = m_plans[ PlanKey(nfft,inverse) ];
       if ( pd.m_twiddles.size() == 0 ) {
-        pd.make_twiddles(nfft,inverse);
-        pd.factorize(nfft);
+        typename PlanMap::const_iterator other = m_plans.find( PlanKey(nfft,!inverse) );
+        if ( other != m_plans.end() && other->second.m_twiddles.size() != 0 ) {
+          pd.make_conjugate(other->second);
+        }else{
+          pd.make_twiddles(nfft,inverse);
+          pd.factorize(nfft);
+        }
       }
       return pd;
     }
 
+  // 1D FFTs of the n0 contiguous rows, then of the n1 columns (strided by n1)
+  inline
+    void work2( Complex * dst,const Complex *src,int n0,int n1,bool inverse)
+    {
+      PlanData & row_plan = get_plan(n1,inverse);
+      for (int i0=0;i0<n0;++i0)
+        row_plan.work(0, dst+i0*n1, src+i0*n1, 1,1);
+
+      PlanData & col_plan = get_plan(n0,inverse);
+      m_tmpBuf1.resize(n0);
+      for (int i1=0;i1<n1;++i1) {
+        col_plan.work(0, &m_tmpBuf1[0], dst+i1, 1,n1);
+        for (int i0=0;i0<n0;++i0)
+          dst[i0*n1+i1] = m_tmpBuf1[i0];
+      }
+    }
+
   inline
     Complex * real_twiddles(int ncfft2)
     {
@@ -0,0 +1,272 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_PARALLEL_MARKET_IO_H
+#define EIGEN_PARALLEL_MARKET_IO_H
+
+// This file uses the task helpers of ParallelSparseProduct.h and the memory
+// mapping of SparseSnapshot.h.
+
+namespace Eigen {
+
+namespace internal {
+
+inline bool market_is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* market_skip_blanks(const char* p, const char* end)
+{
+  while (p != end && market_is_blank(*p)) ++p;
+  return p;
+}
+
+// Parses a decimal integer. \returns the end of the token, or 0 on error.
+template<typename IndexType>
+const char* market_parse_index(const char* p, const char* end, IndexType& value)
+{
+  p = market_skip_blanks(p, end);
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+'))
+    negative = (*p++ == '-');
+  if (p == end || *p < '0' || *p > '9')
+    return 0;
+  numext::int64_t v = 0;
+  for (; p != end && *p >= '0' && *p <= '9'; ++p)
+    v = 10 * v + (*p - '0');
+  value = static_cast<IndexType>(negative ? -v : v);
+  return p;
+}
+
+// strtod in the "C" locale, whatever the LC_NUMERIC of the program.
+inline double market_strtod(const char* str, char** str_end)
+{
+  static const locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+  return c_locale ? strtod_l(str, str_end, c_locale) : std::strtod(str, str_end);
+}
+
+// Parses a real number independently of the locale. Numbers with at most 19
+// significant digits, which form an integer of at most 2^53, times a power of
+// ten between 1e-22 and 1e22 are computed with a single, correctly rounded,
+// floating point operation. The other ones (long mantissas, large exponents,
+// inf, nan) fall back to strtod in the "C" locale, directly on the mapped
+// data: the blank or newline ending the token also stops strtod.
+// \returns the end of the token, or 0 on error.
+inline const char* market_parse_real(const char* p, const char* end, double& value)
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+  p = market_skip_blanks(p, end);
+  const char* start = p;
+  bool negative = false;
+  if (p != end && (*p == '-' || *p == '+'))
+    negative = (*p++ == '-');
+
+  // The digits after the 19th significant one are dropped, and the number
+  // then goes to the slow path.
+  numext::uint64_t mantissa = 0;
+  int digits = 0, exponent = 0;
+  bool any_digit = false, dropped = false;
+  for (; p != end && *p >= '0' && *p <= '9'; ++p, any_digit = true)
+  {
+    if (digits < 19) { mantissa = 10 * mantissa + numext::uint64_t(*p - '0'); if (mantissa) ++digits; }
+    else { ++exponent; dropped = true; }
+  }
+  if (p != end && *p == '.')
+  {
+    for (++p; p != end && *p >= '0' && *p <= '9'; ++p, any_digit = true)
+    {
+      if (digits < 19) { mantissa = 10 * mantissa + numext::uint64_t(*p - '0'); if (mantissa) ++digits; --exponent; }
+      else dropped = true;
+    }
+  }
+  bool fast = any_digit && !dropped;
+  if (any_digit && p != end && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    bool negative_exponent = false;
+    if (p != end && (*p == '-' || *p == '+'))
+      negative_exponent = (*p++ == '-');
+    if (p == end || *p < '0' || *p > '9')
+      return 0;
+    int e = 0;
+    for (; p != end && *p >= '0' && *p <= '9'; ++p)
+      if (e < 100000) e = 10 * e + (*p - '0');
+    exponent += negative_exponent ? -e : e;
+  }
+  fast = fast && (p == end || market_is_blank(*p) || *p == '\n')
+              && mantissa <= (numext::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22;
+
+  if (fast)
+  {
+    const double m = static_cast<double>(mantissa);
+    value = exponent >= 0 ? m * powers[exponent] : m / powers[-exponent];
+    if (negative) value = -value;
+    return p;
+  }
+
+  // Slow path. Only the last token of a file that does not end with a newline
+  // has nothing after it to stop strtod, and is copied.
+  while (p != end && !market_is_blank(*p) && *p != '\n') ++p;
+  if (p == start)
+    return 0;
+  char* token_end = 0;
+  if (p != end)
+  {
+    value = market_strtod(start, &token_end);
+    return token_end == p ? p : 0;
+  }
+  const std::string token(start, p);
+  value = market_strtod(token.c_str(), &token_end);
+  return token_end == token.c_str() + token.size() ? p : 0;
+}
+
+template<typename Scalar>
+const char* market_parse_value(const char* p, const char* end, Scalar& value)
+{
+  double v;
+  p = market_parse_real(p, end, v);
+  value = static_cast<Scalar>(v);
+  return p;
+}
+
+template<typename RealScalar>
+const char* market_parse_value(const char* p, const char* end, std::complex<RealScalar>& value)
+{
+  double re, im;
+  p = market_parse_real(p, end, re);
+  if (p) p = market_parse_real(p, end, im);
+  if (p) value = std::complex<RealScalar>(static_cast<RealScalar>(re), static_cast<RealScalar>(im));
+  return p;
+}
+
+// A data line holds an entry unless it is blank or a comment.
+inline bool market_is_entry(const char* line, const char* end)
+{
+  line = market_skip_blanks(line, end);
+  return line != end && *line != '\n' && *line != '%';
+}
+
+inline const char* market_next_line(const char* p, const char* end)
+{
+  const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+  return eol ? eol + 1 : end;
+}
+
+} // end namespace internal
+
+/** \ingroup SparseExtra_Module
+  * \brief Loads the Matrix Market file \a filename into \a mat using the threads of \a pool.
+  *
+  * The file is mapped in memory and its data lines are split in ranges parsed in parallel, each thread writing its
+  * entries directly at their final position in the triplet list. The numbers are parsed independently of the C
+  * locale. The matrix is then assembled by parallelSetFromTriplets().
+  *
+  * Like loadMarket(SparseMatrixType&, const std::string&), the entries are stored as they appear in the file, even
+  * for a symmetric matrix, and the entries with invalid indices are skipped. The entries of a \c pattern matrix are
+  * set to one.
+  *
+  * \returns true on success, false if the file cannot be mapped or its header cannot be read
+  * \sa loadMarket(SparseMatrixType&, const std::string&), parallelSetFromTriplets(), saveSparseSnapshot()
+  */
+template<typename SparseMatrixType>
+bool loadMarket(ThreadPoolInterface& pool, SparseMatrixType& mat, const std::string& filename)
+{
+  typedef typename SparseMatrixType::Scalar Scalar;
+  typedef typename SparseMatrixType::StorageIndex StorageIndex;
+  typedef Triplet<Scalar,StorageIndex> T;
+
+  internal::sparse_mapped_file file;
+  if (!file.map(filename))
+    return false;
+  const char* p = file.data();
+  const char* const end = p + file.size();
+
+  // Header: the banner and the comments, then the sizes.
+  bool pattern = false;
+  if (p != end && *p == '%')
+  {
+    const char* eol = internal::market_next_line(p, end);
+    pattern = std::string(p, eol).find("pattern") != std::string::npos;
+  }
+  while (p != end && !internal::market_is_entry(p, end))
+    p = internal::market_next_line(p, end);
+  Index M(-1), N(-1), NNZ(-1);
+  const char* q = internal::market_parse_index(p, end, M);
+  if (q) q = internal::market_parse_index(q, end, N);
+  if (q) q = internal::market_parse_index(q, end, NNZ);
+  if (!q || M <= 0 || N <= 0)
+    return false;
+  p = internal::market_next_line(q, end);
+  mat.resize(M, N);
+
+  // Split the data lines at line boundaries.
+  const Index bytes = end - p;
+  const Index num_tasks = internal::sparse_parallel_num_tasks(pool, double(bytes) / 16, 4 * (pool.NumThreads() + 1));
+  std::vector<const char*> boundaries(num_tasks + 1);
+  boundaries[0] = p;
+  boundaries[num_tasks] = end;
+  for (Index t = 1; t < num_tasks; ++t)
+  {
+    const char* b = p + bytes * t / num_tasks;
+    boundaries[t] = b == p ? p : internal::market_next_line(b - 1, end);
+    if (boundaries[t] < boundaries[t-1]) boundaries[t] = boundaries[t-1];
+  }
+
+  // Count the entries of every range to know where it writes its triplets.
+  std::vector<Index> offsets(num_tasks + 1, 0);
+  internal::sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    Index count = 0;
+    for (const char* line = boundaries[t]; line != boundaries[t+1]; line = internal::market_next_line(line, end))
+      count += internal::market_is_entry(line, end);
+    offsets[t+1] = count;
+  });
+  for (Index t = 0; t < num_tasks; ++t)
+    offsets[t+1] += offsets[t];
+
+  std::vector<T> elements(offsets[num_tasks]);
+  std::vector<Index> valid(num_tasks, 0);
+  internal::sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    T* out = elements.data() + offsets[t];
+    for (const char* line = boundaries[t]; line != boundaries[t+1]; line = internal::market_next_line(line, end))
+    {
+      if (!internal::market_is_entry(line, end))
+        continue;
+      StorageIndex i(-1), j(-1);
+      Scalar value(1);
+      const char* r = internal::market_parse_index(line, end, i);
+      if (r) r = internal::market_parse_index(r, end, j);
+      if (r && !pattern) r = internal::market_parse_value(r, end, value);
+      --i;
+      --j;
+      if (r && i >= 0 && j >= 0 && i < M && j < N)
+        *out++ = T(i, j, value);
+    }
+    valid[t] = out - (elements.data() + offsets[t]);
+  });
+
+  // Pack the ranges if some entries were skipped.
+  Index count = 0;
+  for (Index t = 0; t < num_tasks; ++t)
+  {
+    if (count != offsets[t])
+      std::copy(elements.begin() + offsets[t], elements.begin() + offsets[t] + valid[t], elements.begin() + count);
+    count += valid[t];
+  }
+  if (count != offsets[num_tasks])
+  {
+    std::cerr << "Invalid read: " << offsets[num_tasks] - count << " entries skipped\n";
+    elements.resize(count);
+  }
+
+  parallelSetFromTriplets(pool, elements.begin(), elements.end(), mat);
+  if (count != NNZ)
+    std::cerr << count << "!=" << NNZ << "\n";
+  return true;
+}
+
+} // end namespace Eigen
+
+#endif // EIGEN_PARALLEL_MARKET_IO_H
@@ -0,0 +1,203 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_PARALLEL_SPARSE_ASSEMBLY_H
+#define EIGEN_PARALLEL_SPARSE_ASSEMBLY_H
+
+// This file uses the task helpers of ParallelSparseProduct.h.
+
+namespace Eigen {
+
+namespace internal {
+
+// Orders (inner index, value) pairs by inner index only, so that a stable sort
+// keeps the duplicates in their input order.
+template<typename Entry>
+struct sparse_entry_less
+{
+  bool operator()(const Entry& a, const Entry& b) const { return a.first < b.first; }
+};
+
+template<typename InputIterator, typename SparseMatrixType, typename DupFunctor>
+void parallel_set_from_triplets(ThreadPoolInterface& pool, const InputIterator& begin, const InputIterator& end,
+                                SparseMatrixType& mat, DupFunctor dup_func)
+{
+  enum { IsRowMajor = SparseMatrixType::IsRowMajor };
+  typedef typename SparseMatrixType::Scalar Scalar;
+  typedef typename SparseMatrixType::StorageIndex StorageIndex;
+  typedef typename SparseMatrixType::IndexVector IndexVector;
+
+  mat.resize(mat.rows(), mat.cols());
+  const Index outerSize = mat.outerSize();
+  const Index size = static_cast<Index>(end - begin);
+  if (size == 0) return;
+
+  // Every task owns a contiguous range of triplets and a histogram of their
+  // outer indices, so the number of tasks is bounded by the number of threads.
+  const Index num_tasks = sparse_parallel_num_tasks(pool, double(size), pool.NumThreads() + 1);
+  std::vector<IndexVector> counts(num_tasks);
+
+  // pass 1: count the nnz per outer vector and per task
+  sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    IndexVector& count = counts[t];
+    count.setZero(outerSize);
+    const InputIterator first = begin + size * t / num_tasks;
+    const InputIterator last = begin + size * (t + 1) / num_tasks;
+    for (InputIterator it(first); it != last; ++it)
+    {
+      eigen_assert(it->row()>=0 && it->row()<mat.rows() && it->col()>=0 && it->col()<mat.cols());
+      count(IsRowMajor ? it->row() : it->col())++;
+    }
+  });
+
+  IndexVector sizes(outerSize);
+  const Index num_outer_tasks = sparse_parallel_num_tasks(pool, double(outerSize) * double(num_tasks), outerSize);
+  sparse_parallel_for(pool, num_outer_tasks, [&](Index t) {
+    const Index first = outerSize * t / num_outer_tasks;
+    const Index last = outerSize * (t + 1) / num_outer_tasks;
+    sizes.segment(first, last - first).setZero();
+    for (Index k = 0; k < num_tasks; ++k)
+      sizes.segment(first, last - first) += counts[k].segment(first, last - first);
+  });
+
+  // Allocates the storage in uncompressed mode: every outer vector gets room for
+  // all its triplets, duplicates included.
+  mat.reserve(sizes);
+  const StorageIndex* outerIndex = mat.outerIndexPtr();
+  StorageIndex* innerIndex = mat.innerIndexPtr();
+  Scalar* values = mat.valuePtr();
+
+  // Turn the histograms into the position where each task writes its next
+  // element of every outer vector. The elements of an outer vector are thus
+  // stored in the order of the input.
+  sparse_parallel_for(pool, num_outer_tasks, [&](Index t) {
+    const Index first = outerSize * t / num_outer_tasks;
+    const Index last = outerSize * (t + 1) / num_outer_tasks;
+    for (Index j = first; j < last; ++j)
+    {
+      StorageIndex pos = outerIndex[j];
+      for (Index k = 0; k < num_tasks; ++k)
+      {
+        const StorageIndex n = counts[k](j);
+        counts[k](j) = pos;
+        pos += n;
+      }
+    }
+  });
+
+  // pass 2: scatter the triplets
+  sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    IndexVector& pos = counts[t];
+    const InputIterator first = begin + size * t / num_tasks;
+    const InputIterator last = begin + size * (t + 1) / num_tasks;
+    for (InputIterator it(first); it != last; ++it)
+    {
+      const StorageIndex p = pos(IsRowMajor ? it->row() : it->col())++;
+      innerIndex[p] = StorageIndex(IsRowMajor ? it->col() : it->row());
+      values[p] = it->value();
+    }
+  });
+  counts.clear();
+
+  // pass 3: sort every outer vector and collapse its duplicates in place
+  std::vector<Index> boundaries;
+  const Index num_sort_tasks = sparse_parallel_num_tasks(pool, double(size), outerSize);
+  sparse_balanced_partition(outerSize, num_sort_tasks, sparse_outer_weight<StorageIndex>(outerIndex), boundaries);
+  StorageIndex* innerNonZeros = mat.innerNonZeroPtr();
+  std::vector<char> collapsed(num_sort_tasks, 0);
+  sparse_parallel_for(pool, num_sort_tasks, [&](Index t) {
+    typedef std::pair<StorageIndex,Scalar> Entry;
+    std::vector<Entry> entries;
+    for (Index j = boundaries[t]; j < boundaries[t+1]; ++j)
+    {
+      const StorageIndex start = outerIndex[j];
+      const StorageIndex n = sizes(j);
+      StorageIndex sorted = 1;
+      while (sorted < n && innerIndex[start + sorted - 1] < innerIndex[start + sorted]) ++sorted;
+      if (sorted >= n)
+      {
+        innerNonZeros[j] = n;
+        continue;
+      }
+
+      entries.resize(n);
+      for (StorageIndex k = 0; k < n; ++k)
+        entries[k] = Entry(innerIndex[start + k], values[start + k]);
+      std::stable_sort(entries.begin(), entries.end(), sparse_entry_less<Entry>());
+
+      StorageIndex nnz = 0;
+      for (StorageIndex k = 0; k < n; ++k)
+      {
+        if (nnz > 0 && innerIndex[start + nnz - 1] == entries[k].first)
+          values[start + nnz - 1] = dup_func(values[start + nnz - 1], entries[k].second);
+        else
+        {
+          innerIndex[start + nnz] = entries[k].first;
+          values[start + nnz] = entries[k].second;
+          ++nnz;
+        }
+      }
+      innerNonZeros[j] = nnz;
+      collapsed[t] |= (nnz < n);
+    }
+  });
+
+  // pass 4: back to compressed mode. When duplicates were collapsed, the
+  // remaining elements are packed in place by collapseDuplicates(), which, unlike
+  // makeCompressed(), does not reallocate the storage to its exact size.
+  if (std::find(collapsed.begin(), collapsed.end(), 1) != collapsed.end())
+    mat.collapseDuplicates(dup_func);
+  else
+    mat.makeCompressed();
+}
+
+} // end namespace internal
+
+/** \ingroup SparseExtra_Module
+  * \brief Fills \a mat from the triplets of the range \a begin - \a end using the threads of \a pool.
+  *
+  * This is the parallel counterpart of SparseMatrix::setFromTriplets(): the result is the same \b sorted and
+  * \b compressed matrix in which the duplicates have been summed up. The sizes of \a mat must be set beforehand and
+  * are not extracted from the triplet list.
+  *
+  * The triplets are counted with one histogram per task, scattered in parallel directly into the storage of
+  * \a mat, then every inner vector is sorted and its duplicates collapsed in parallel. Unlike
+  * SparseMatrix::setFromTriplets(), no temporary transposed matrix is built: the peak memory is about the storage
+  * of one value and one index per triplet, plus one histogram of the outer indices per thread.
+  *
+  * \a InputIterators must be random access iterators, such as the ones of a std::vector of Eigen::Triplet.
+  *
+  * The calling thread takes part in the computation and blocks until it is done, so this function must not be
+  * called from a task that the pool needs to make progress.
+  *
+  * \sa SparseMatrix::setFromTriplets()
+  */
+template<typename InputIterators, typename Scalar, int Options, typename StorageIndex>
+void parallelSetFromTriplets(ThreadPoolInterface& pool, const InputIterators& begin, const InputIterators& end,
+                             SparseMatrix<Scalar,Options,StorageIndex>& mat)
+{
+  internal::parallel_set_from_triplets(pool, begin, end, mat, internal::scalar_sum_op<Scalar,Scalar>());
+}
+
+/** \ingroup SparseExtra_Module
+  * The same as parallelSetFromTriplets(ThreadPoolInterface&, const InputIterators&, const InputIterators&, SparseMatrix<Scalar,Options,StorageIndex>&)
+  * but when duplicates are met the functor \a dup_func is applied, in the order of the triplet list:
+  * \code
+  * value = dup_func(OldValue, NewValue)
+  * \endcode
+  * \a dup_func is called concurrently from several threads and must be thread safe.
+  */
+template<typename InputIterators, typename Scalar, int Options, typename StorageIndex, typename DupFunctor>
+void parallelSetFromTriplets(ThreadPoolInterface& pool, const InputIterators& begin, const InputIterators& end,
+                             SparseMatrix<Scalar,Options,StorageIndex>& mat, DupFunctor dup_func)
+{
+  internal::parallel_set_from_triplets(pool, begin, end, mat, dup_func);
+}
+
+} // end namespace Eigen
+
+#endif // EIGEN_PARALLEL_SPARSE_ASSEMBLY_H
@@ -0,0 +1,314 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_PARALLEL_SPARSE_PRODUCT_H
+#define EIGEN_PARALLEL_SPARSE_PRODUCT_H
+
+namespace Eigen {
+
+namespace internal {
+
+// Runs f(task) for every task in [0, num_tasks) on the pool and waits for all
+// of them. Task 0 runs on the calling thread.
+template <typename Function>
+void sparse_parallel_for(ThreadPoolInterface& pool, Index num_tasks, const Function& f)
+{
+  if (num_tasks <= 1) {
+    if (num_tasks == 1) f(0);
+    return;
+  }
+  Barrier barrier(static_cast<unsigned int>(num_tasks - 1));
+  for (Index t = 1; t < num_tasks; ++t)
+    pool.Schedule([&f, &barrier, t]() {
+      f(t);
+      barrier.Notify();
+    });
+  f(0);
+  barrier.Wait();
+}
+
+// Number of tasks for an operation doing about `work` multiply-adds. This
+// 20000 threshold is the one used by the OpenMP paths of SparseDenseProduct.h:
+// it is the minimal amount of work for which a task is worth it. A few tasks
+// per thread give the work stealing room to balance the load.
+inline Index sparse_parallel_num_tasks(const ThreadPoolInterface& pool, double work, Index max_tasks)
+{
+  const double min_work_per_task = 20000;
+  Index num_tasks = static_cast<Index>(work / min_work_per_task);
+  num_tasks = numext::mini<Index>(num_tasks, 4 * (pool.NumThreads() + 1));
+  num_tasks = numext::mini<Index>(num_tasks, max_tasks);
+  return numext::maxi<Index>(num_tasks, 1);
+}
+
+// Splits [0, size) into num_tasks contiguous ranges of about equal weight.
+// weight(i) is the cumulative weight of [0, i) and must be non-decreasing.
+// On return, task t owns [boundaries[t], boundaries[t+1]).
+template <typename Weight>
+void sparse_balanced_partition(Index size, Index num_tasks, const Weight& weight, std::vector<Index>& boundaries)
+{
+  boundaries.resize(num_tasks + 1);
+  const double total = static_cast<double>(weight(size));
+  boundaries[0] = 0;
+  for (Index t = 1; t < num_tasks; ++t)
+  {
+    const double target = total * static_cast<double>(t) / static_cast<double>(num_tasks);
+    Index lo = boundaries[t-1], hi = size;
+    while (lo < hi)
+    {
+      const Index mid = lo + (hi - lo) / 2;
+      if (static_cast<double>(weight(mid)) < target) lo = mid + 1;
+      else hi = mid;
+    }
+    boundaries[t] = lo;
+  }
+  boundaries[num_tasks] = size;
+}
+
+// Cumulative weight of the first i outer vectors of a compressed sparse
+// matrix: their non zeros plus one per vector, so that empty vectors still
+// count for the writes they generate.
+template <typename StorageIndex>
+struct sparse_outer_weight
+{
+  explicit sparse_outer_weight(const StorageIndex* outer) : m_outer(outer) {}
+  Index operator()(Index i) const { return Index(m_outer[i]) - Index(m_outer[0]) + i; }
+  const StorageIndex* m_outer;
+};
+
+template <typename Lhs, typename Rhs, typename Dest>
+void parallel_sparse_dense_product(ThreadPoolInterface& pool, const Lhs& lhs, const Rhs& rhs, Dest& dst, true_type /* row major lhs */)
+{
+  typedef evaluator<Lhs> LhsEval;
+  typedef typename LhsEval::InnerIterator LhsInnerIterator;
+  typedef typename Dest::Scalar Scalar;
+
+  const Index rows = lhs.outerSize();
+  const double work = double(lhs.nonZeros()) * double(rhs.cols());
+  const Index num_tasks = sparse_parallel_num_tasks(pool, work, rows);
+
+  std::vector<Index> boundaries;
+  sparse_balanced_partition(rows, num_tasks, sparse_outer_weight<typename Lhs::StorageIndex>(lhs.outerIndexPtr()), boundaries);
+
+  LhsEval lhsEval(lhs);
+  // Each task owns a range of result rows: no synchronization is needed.
+  sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    for (Index c = 0; c < rhs.cols(); ++c)
+    {
+      for (Index i = boundaries[t]; i < boundaries[t+1]; ++i)
+      {
+        Scalar tmp(0);
+        for (LhsInnerIterator it(lhsEval, i); it; ++it)
+          tmp += it.value() * rhs.coeff(it.index(), c);
+        dst.coeffRef(i, c) = tmp;
+      }
+    }
+  });
+}
+
+template <typename Lhs, typename Rhs, typename Dest>
+void parallel_sparse_dense_product(ThreadPoolInterface& pool, const Lhs& lhs, const Rhs& rhs, Dest& dst, false_type /* column major lhs */)
+{
+  typedef evaluator<Lhs> LhsEval;
+  typedef typename LhsEval::InnerIterator LhsInnerIterator;
+  typedef typename Dest::Scalar Scalar;
+  typedef Matrix<Scalar, Dynamic, Dynamic> Buffer;
+
+  // Every task scatters into a private buffer the size of the result, so the
+  // number of tasks is bounded by the number of threads.
+  const Index cols = lhs.outerSize();
+  const double work = double(lhs.nonZeros()) * double(rhs.cols());
+  const Index num_tasks = sparse_parallel_num_tasks(pool, work, numext::mini<Index>(cols, pool.NumThreads() + 1));
+
+  std::vector<Index> boundaries;
+  sparse_balanced_partition(cols, num_tasks, sparse_outer_weight<typename Lhs::StorageIndex>(lhs.outerIndexPtr()), boundaries);
+
+  LhsEval lhsEval(lhs);
+  std::vector<Buffer> partial(num_tasks);
+  sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    Buffer& acc = partial[t];
+    acc.setZero(dst.rows(), dst.cols());
+    for (Index c = 0; c < rhs.cols(); ++c)
+    {
+      for (Index j = boundaries[t]; j < boundaries[t+1]; ++j)
+      {
+        const Scalar rhs_j = rhs.coeff(j, c);
+        for (LhsInnerIterator it(lhsEval, j); it; ++it)
+          acc.coeffRef(it.index(), c) += it.value() * rhs_j;
+      }
+    }
+  });
+
+  // Reduce the partial results, in parallel over ranges of rows.
+  const Index rows = dst.rows();
+  const Index num_reduce_tasks = sparse_parallel_num_tasks(pool, double(rows) * double(dst.cols()) * double(num_tasks), rows);
+  sparse_parallel_for(pool, num_reduce_tasks, [&](Index t) {
+    const Index begin = rows * t / num_reduce_tasks;
+    const Index end = rows * (t + 1) / num_reduce_tasks;
+    dst.middleRows(begin, end - begin) = partial[0].middleRows(begin, end - begin);
+    for (Index k = 1; k < num_tasks; ++k)
+      dst.middleRows(begin, end - begin) += partial[k].middleRows(begin, end - begin);
+  });
+}
+
+template <typename Scalar, typename StorageIndex>
+void parallel_sparse_sparse_product(ThreadPoolInterface& pool,
+                                    const Ref<const SparseMatrix<Scalar,ColMajor,StorageIndex>, StandardCompressedFormat>& lhs,
+                                    const Ref<const SparseMatrix<Scalar,ColMajor,StorageIndex>, StandardCompressedFormat>& rhs,
+                                    SparseMatrix<Scalar,ColMajor,StorageIndex>& res)
+{
+  const Index rows = lhs.rows();
+  const Index cols = rhs.cols();
+  const StorageIndex* lhsOuter = lhs.outerIndexPtr();
+  const StorageIndex* lhsInner = lhs.innerIndexPtr();
+  const Scalar* lhsValues = lhs.valuePtr();
+  const StorageIndex* rhsOuter = rhs.outerIndexPtr();
+  const StorageIndex* rhsInner = rhs.innerIndexPtr();
+  const Scalar* rhsValues = rhs.valuePtr();
+
+  // Number of multiply-adds needed by the first j columns of the result,
+  // used to balance the columns between the tasks.
+  std::vector<Index> flops(cols + 1);
+  flops[0] = 0;
+  for (Index j = 0; j < cols; ++j)
+  {
+    Index f = 0;
+    for (StorageIndex p = rhsOuter[j]; p < rhsOuter[j+1]; ++p)
+      f += lhsOuter[rhsInner[p] + 1] - lhsOuter[rhsInner[p]];
+    flops[j+1] = flops[j] + f + 1;
+  }
+
+  const Index num_tasks = sparse_parallel_num_tasks(pool, double(flops[cols]), cols);
+  std::vector<Index> boundaries;
+  sparse_balanced_partition(cols, num_tasks, [&flops](Index j) { return flops[j]; }, boundaries);
+
+  // Symbolic phase: count the non zeros of every result column.
+  res.resize(rows, cols);
+  StorageIndex* resOuter = res.outerIndexPtr();
+  sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    std::vector<Index> mask(rows, -1);
+    for (Index j = boundaries[t]; j < boundaries[t+1]; ++j)
+    {
+      StorageIndex nnz = 0;
+      for (StorageIndex p = rhsOuter[j]; p < rhsOuter[j+1]; ++p)
+      {
+        const Index k = rhsInner[p];
+        for (StorageIndex q = lhsOuter[k]; q < lhsOuter[k+1]; ++q)
+        {
+          const Index i = lhsInner[q];
+          if (mask[i] != j)
+          {
+            mask[i] = j;
+            ++nnz;
+          }
+        }
+      }
+      resOuter[j+1] = nnz;
+    }
+  });
+
+  resOuter[0] = 0;
+  for (Index j = 0; j < cols; ++j)
+    resOuter[j+1] += resOuter[j];
+  res.resizeNonZeros(resOuter[cols]);
+
+  // Numeric phase: every task accumulates its columns in a dense buffer and
+  // writes them, with sorted inner indices, at their final position.
+  StorageIndex* resInner = res.innerIndexPtr();
+  Scalar* resValues = res.valuePtr();
+  sparse_parallel_for(pool, num_tasks, [&](Index t) {
+    std::vector<Index> mask(rows, -1);
+    std::vector<Scalar> values(rows);
+    for (Index j = boundaries[t]; j < boundaries[t+1]; ++j)
+    {
+      StorageIndex nnz = resOuter[j];
+      for (StorageIndex p = rhsOuter[j]; p < rhsOuter[j+1]; ++p)
+      {
+        const Index k = rhsInner[p];
+        const Scalar y = rhsValues[p];
+        for (StorageIndex q = lhsOuter[k]; q < lhsOuter[k+1]; ++q)
+        {
+          const Index i = lhsInner[q];
+          if (mask[i] != j)
+          {
+            mask[i] = j;
+            values[i] = lhsValues[q] * y;
+            resInner[nnz++] = StorageIndex(i);
+          }
+          else
+            values[i] += lhsValues[q] * y;
+        }
+      }
+      std::sort(resInner + resOuter[j], resInner + resOuter[j+1]);
+      for (StorageIndex p = resOuter[j]; p < resOuter[j+1]; ++p)
+        resValues[p] = values[resInner[p]];
+    }
+  });
+}
+
+template <typename Scalar, typename StorageIndex>
+void parallel_product_assign(SparseMatrix<Scalar,ColMajor,StorageIndex>& dst, SparseMatrix<Scalar,ColMajor,StorageIndex>& src)
+{
+  dst.swap(src);
+}
+
+template <typename Scalar, typename StorageIndex>
+void parallel_product_assign(SparseMatrix<Scalar,RowMajor,StorageIndex>& dst, SparseMatrix<Scalar,ColMajor,StorageIndex>& src)
+{
+  dst = src;
+}
+
+} // end namespace internal
+
+/** \ingroup SparseExtra_Module
+  * \brief Computes \a dst = \a lhs * \a rhs for a sparse \a lhs and a dense \a rhs using the threads of \a pool.
+  *
+  * \a lhs must be stored in a compressed format (SparseMatrix, Map or Ref). The outer vectors of \a lhs are split
+  * into ranges holding about the same number of non zeros, and each range is handled by one task:
+  *  - for a row major \a lhs, each task computes its own rows of \a dst;
+  *  - for a column major \a lhs, each task scatters into a private buffer of the size of \a dst, and the buffers are
+  *    then summed in parallel. Prefer a row major \a lhs for large results.
+  *
+  * Small products are computed on the calling thread. The calling thread takes part in the computation and blocks
+  * until it is done, so this function must not be called from a task that the pool needs to make progress.
+  *
+  * \sa parallelProduct(ThreadPoolInterface&, const SparseMatrixBase<Lhs>&, const SparseMatrixBase<Rhs>&, SparseMatrix<Scalar,Options,StorageIndex>&)
+  */
+template <typename Lhs, typename Rhs, typename Dest>
+void parallelProduct(ThreadPoolInterface& pool, const SparseCompressedBase<Lhs>& lhs, const MatrixBase<Rhs>& rhs, MatrixBase<Dest>& dst)
+{
+  eigen_assert(lhs.cols() == rhs.rows() && "invalid matrix product");
+  typename internal::nested_eval<Rhs, Dynamic>::type rhsNested(rhs.derived());
+  dst.derived().resize(lhs.rows(), rhs.cols());
+  internal::parallel_sparse_dense_product(pool, lhs.derived(), rhsNested, dst.derived(),
+                                          internal::bool_constant<bool(Lhs::IsRowMajor)>());
+}
+
+/** \ingroup SparseExtra_Module
+  * \brief Computes \a dst = \a lhs * \a rhs for two sparse matrices using the threads of \a pool.
+  *
+  * The product runs in two phases over ranges of result columns balanced by their number of multiply-adds: a symbolic
+  * phase counts the non zeros of every column of the result, then a numeric phase fills them in place. The result
+  * is compressed, holds no explicit zeros other than numerical cancellations, and has sorted inner indices.
+  *
+  * Operands that are not column major and compressed are first copied into such a matrix.
+  *
+  * \sa parallelProduct(ThreadPoolInterface&, const SparseCompressedBase<Lhs>&, const MatrixBase<Rhs>&, MatrixBase<Dest>&)
+  */
+template <typename Lhs, typename Rhs, typename Scalar, int Options, typename StorageIndex>
+void parallelProduct(ThreadPoolInterface& pool, const SparseMatrixBase<Lhs>& lhs, const SparseMatrixBase<Rhs>& rhs,
+                     SparseMatrix<Scalar,Options,StorageIndex>& dst)
+{
+  eigen_assert(lhs.cols() == rhs.rows() && "invalid matrix product");
+  typedef SparseMatrix<Scalar,ColMajor,StorageIndex> ColMajorMatrix;
+  ColMajorMatrix res;
+  internal::parallel_sparse_sparse_product<Scalar,StorageIndex>(pool, lhs.derived(), rhs.derived(), res);
+  internal::parallel_product_assign(dst, res);
+}
+
+} // end namespace Eigen
+
+#endif // EIGEN_PARALLEL_SPARSE_PRODUCT_H
@@ -0,0 +1,313 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_SELL_C_SIGMA_MATRIX_H
+#define EIGEN_SELL_C_SIGMA_MATRIX_H
+
+namespace Eigen {
+
+template<typename _Scalar, int _ChunkSize = 2 * internal::packet_traits<_Scalar>::size, typename _StorageIndex = int>
+class SellCSigmaMatrix;
+
+namespace internal {
+// SellCSigmaMatrix behaves like a row major SparseMatrix for the iterative solvers.
+template<typename _Scalar, int _ChunkSize, typename _StorageIndex>
+struct traits<SellCSigmaMatrix<_Scalar,_ChunkSize,_StorageIndex> >
+  : public traits<SparseMatrix<_Scalar,RowMajor,_StorageIndex> >
+{};
+
+// Orders the rows of a compressed matrix by decreasing number of non zeros.
+template<typename StorageIndex>
+struct sell_longer_row
+{
+  explicit sell_longer_row(const StorageIndex* outer) : m_outer(outer) {}
+  bool operator()(StorageIndex a, StorageIndex b) const
+  { return m_outer[a+1] - m_outer[a] > m_outer[b+1] - m_outer[b]; }
+  const StorageIndex* m_outer;
+};
+} // end namespace internal
+
+/** \ingroup SparseExtra_Module
+  * \class SellCSigmaMatrix
+  *
+  * \brief A read-only sparse matrix stored in the SELL-C-sigma format for fast matrix-vector products
+  *
+  * The rows are grouped in chunks of \a C consecutive rows, and each chunk is stored as a dense column major
+  * \a C x \a w block, \a w being the length of the longest row of the chunk. Shorter rows are padded with explicit
+  * zeros. The rows of a chunk are then multiplied in lock step, with one independent accumulator per row, which
+  * the compiler turns into SIMD multiply-adds over packets of values and gathered right hand side coefficients.
+  *
+  * To limit the padding, the rows are sorted by decreasing length inside windows of \a sigma consecutive rows
+  * before being chunked. The permutation is internal: products and iterators use the original row indices.
+  * A larger \a sigma reduces the padding, a smaller one better preserves the locality of the accesses to the
+  * right hand side.
+  *
+  * The matrix is built from any sparse matrix expression and only supports products with dense matrices:
+  * \code
+  * SparseMatrix<double> A = ...;
+  * SellCSigmaMatrix<double> S(A);
+  * y = S * x;
+  * \endcode
+  *
+  * It can be used as a matrix-free operator by the iterative solvers. Since it always stores the full matrix,
+  * use \c Lower|Upper with ConjugateGradient:
+  * \code
+  * ConjugateGradient<SellCSigmaMatrix<double>, Lower|Upper> cg(S);
+  * x = cg.solve(b);
+  * \endcode
+  *
+  * \tparam _Scalar the scalar type
+  * \tparam _ChunkSize the number of rows \a C per chunk. Multiples of the packet size of \a _Scalar work best; the
+  *                    default is twice the packet size.
+  * \tparam _StorageIndex the type of the column indices
+  */
+template<typename _Scalar, int _ChunkSize, typename _StorageIndex>
+class SellCSigmaMatrix : public EigenBase<SellCSigmaMatrix<_Scalar,_ChunkSize,_StorageIndex> >
+{
+  public:
+    typedef _Scalar Scalar;
+    typedef typename NumTraits<Scalar>::Real RealScalar;
+    typedef _StorageIndex StorageIndex;
+    typedef Matrix<Scalar,Dynamic,1> ScalarVector;
+    typedef Matrix<StorageIndex,Dynamic,1> IndexVector;
+    typedef Matrix<Index,Dynamic,1> OffsetVector;
+
+    enum {
+      ChunkSize = _ChunkSize,
+      ColsAtCompileTime = Dynamic,
+      MaxColsAtCompileTime = Dynamic,
+      IsRowMajor = true,
+      /** Default size of the sorting windows, in number of chunks */
+      DefaultSortingChunks = 32
+    };
+
+    EIGEN_STATIC_ASSERT(ChunkSize > 0, INVALID_MATRIX_TEMPLATE_PARAMETERS)
+
+    class InnerIterator;
+
+    SellCSigmaMatrix() : m_rows(0), m_cols(0), m_nonZeros(0), m_sigma(1) {}
+
+    /** Builds the SELL-C-sigma representation of \a mat, sorting the rows inside windows of \a sigma rows.
+      * \sa compute() */
+    template<typename MatrixDerived>
+    explicit SellCSigmaMatrix(const SparseMatrixBase<MatrixDerived>& mat, Index sigma = DefaultSortingChunks * ChunkSize)
+    {
+      compute(mat, sigma);
+    }
+
+    /** Builds the SELL-C-sigma representation of \a mat, sorting the rows inside windows of \a sigma rows.
+      * A \a sigma of 1 disables the sorting. */
+    template<typename MatrixDerived>
+    SellCSigmaMatrix& compute(const SparseMatrixBase<MatrixDerived>& mat, Index sigma = DefaultSortingChunks * ChunkSize);
+
+    inline Index rows() const { return m_rows; }
+    inline Index cols() const { return m_cols; }
+    inline Index outerSize() const { return m_rows; }
+    inline Index innerSize() const { return m_cols; }
+
+    /** \returns the number of non zeros, padding excluded */
+    inline Index nonZeros() const { return m_nonZeros; }
+    /** \returns the number of stored coefficients, padding included */
+    inline Index storedCoefficients() const { return m_values.size(); }
+    /** \returns the size of the sorting windows */
+    inline Index sortingWindow() const { return m_sigma; }
+    /** \returns the number of chunks */
+    inline Index chunks() const { return m_chunkStart.size() > 0 ? m_chunkStart.size() - 1 : 0; }
+
+    template<typename Rhs>
+    Product<SellCSigmaMatrix,Rhs,AliasFreeProduct> operator*(const MatrixBase<Rhs>& x) const
+    {
+      return Product<SellCSigmaMatrix,Rhs,AliasFreeProduct>(*this, x.derived());
+    }
+
+    /** \internal Computes \a dst += \a alpha * \c *this * \a rhs */
+    template<typename Dest, typename Rhs>
+    void scaleAndAddTo(Dest& dst, const Rhs& rhs, const Scalar& alpha) const;
+
+  protected:
+    template<typename Dest, typename Rhs>
+    void chunkProduct(Index chunk, Dest& dst, const Rhs& rhs, const Scalar& alpha) const;
+
+    Index m_rows;
+    Index m_cols;
+    Index m_nonZeros;
+    Index m_sigma;
+    ScalarVector m_values;        // chunk after chunk, each chunk column by column
+    IndexVector m_indices;        // column index of each entry of m_values
+    OffsetVector m_chunkStart;    // offset of each chunk in m_values, the padding can exceed StorageIndex
+    IndexVector m_rowLength;      // number of non zeros of each sorted row
+    IndexVector m_perm;           // sorted row -> original row
+    IndexVector m_invPerm;        // original row -> sorted row
+};
+
+template<typename Scalar, int ChunkSize, typename StorageIndex>
+template<typename MatrixDerived>
+SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>&
+SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>::compute(const SparseMatrixBase<MatrixDerived>& mat, Index sigma)
+{
+  eigen_assert(sigma > 0 && "the sorting window must hold at least one row");
+  typedef SparseMatrix<Scalar,RowMajor,StorageIndex> RowMajorMatrix;
+  const Ref<const RowMajorMatrix, StandardCompressedFormat> csr(mat.derived());
+
+  m_rows = csr.rows();
+  m_cols = csr.cols();
+  m_nonZeros = csr.nonZeros();
+  m_sigma = sigma;
+  const StorageIndex* outer = csr.outerIndexPtr();
+
+  // Sort the rows by decreasing length inside each window.
+  m_perm.resize(m_rows);
+  for (Index i = 0; i < m_rows; ++i)
+    m_perm(i) = StorageIndex(i);
+  for (Index begin = 0; begin < m_rows; begin += sigma)
+  {
+    const Index end = numext::mini(begin + sigma, m_rows);
+    std::stable_sort(m_perm.data() + begin, m_perm.data() + end, internal::sell_longer_row<StorageIndex>(outer));
+  }
+  m_invPerm.resize(m_rows);
+  m_rowLength.resize(m_rows);
+  for (Index p = 0; p < m_rows; ++p)
+  {
+    m_invPerm(m_perm(p)) = StorageIndex(p);
+    m_rowLength(p) = outer[m_perm(p)+1] - outer[m_perm(p)];
+  }
+
+  // Chunk widths.
+  const Index numChunks = (m_rows + ChunkSize - 1) / ChunkSize;
+  m_chunkStart.resize(numChunks + 1);
+  m_chunkStart(0) = 0;
+  for (Index c = 0; c < numChunks; ++c)
+  {
+    const Index end = numext::mini<Index>((c + 1) * ChunkSize, m_rows);
+    StorageIndex width = 0;
+    for (Index p = c * ChunkSize; p < end; ++p)
+      width = numext::maxi(width, m_rowLength(p));
+    m_chunkStart(c+1) = m_chunkStart(c) + Index(width) * ChunkSize;
+  }
+
+  // Fill the chunks. Padding entries hold a zero and repeat the last column index of their row, or 0 for empty
+  // rows, so that the gathers stay inside the right hand side and close to the other accesses of the row.
+  m_values.resize(m_chunkStart(numChunks));
+  m_indices.resize(m_chunkStart(numChunks));
+  const StorageIndex* inner = csr.innerIndexPtr();
+  const Scalar* values = csr.valuePtr();
+  for (Index c = 0; c < numChunks; ++c)
+  {
+    const Index width = (m_chunkStart(c+1) - m_chunkStart(c)) / ChunkSize;
+    for (Index r = 0; r < ChunkSize; ++r)
+    {
+      const Index p = c * ChunkSize + r;
+      const Index row = p < m_rows ? Index(m_perm(p)) : 0;
+      const Index length = p < m_rows ? Index(m_rowLength(p)) : 0;
+      StorageIndex last = 0;
+      for (Index k = 0; k < width; ++k)
+      {
+        const Index dst = m_chunkStart(c) + k * ChunkSize + r;
+        if (k < length)
+        {
+          last = inner[outer[row] + k];
+          m_values(dst) = values[outer[row] + k];
+        }
+        else
+          m_values(dst) = Scalar(0);
+        m_indices(dst) = last;
+      }
+    }
+  }
+  return *this;
+}
+
+template<typename Scalar, int ChunkSize, typename StorageIndex>
+template<typename Dest, typename Rhs>
+void SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>::chunkProduct(Index chunk, Dest& dst, const Rhs& rhs, const Scalar& alpha) const
+{
+  const Index start = m_chunkStart(chunk);
+  const Index width = (m_chunkStart(chunk+1) - start) / ChunkSize;
+  const Scalar* values = m_values.data() + start;
+  const StorageIndex* indices = m_indices.data() + start;
+  const Index rowEnd = numext::mini<Index>(ChunkSize, m_rows - chunk * ChunkSize);
+
+  for (Index j = 0; j < rhs.cols(); ++j)
+  {
+    // The rows of the chunk advance in lock step, each with its own accumulator. Unlike the single reduction per
+    // row of a CSR product, the inner loop has no dependency and maps onto SIMD multiply-adds and gathers.
+    Scalar acc[ChunkSize];
+    for (int r = 0; r < ChunkSize; ++r)
+      acc[r] = Scalar(0);
+    for (Index k = 0; k < width; ++k)
+      for (int r = 0; r < ChunkSize; ++r)
+        acc[r] += values[k * ChunkSize + r] * rhs.coeff(indices[k * ChunkSize + r], j);
+    for (Index r = 0; r < rowEnd; ++r)
+      dst.coeffRef(m_perm(chunk * ChunkSize + r), j) += alpha * acc[r];
+  }
+}
+
+template<typename Scalar, int ChunkSize, typename StorageIndex>
+template<typename Dest, typename Rhs>
+void SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>::scaleAndAddTo(Dest& dst, const Rhs& rhs, const Scalar& alpha) const
+{
+  eigen_assert(m_cols == rhs.rows() && m_rows == dst.rows() && rhs.cols() == dst.cols());
+  typename internal::nested_eval<Rhs,Dynamic>::type actualRhs(rhs);
+  for (Index c = 0; c < chunks(); ++c)
+    chunkProduct(c, dst, actualRhs, alpha);
+}
+
+/** \ingroup SparseExtra_Module
+  * \brief Iterator over the non zeros of a row of a SellCSigmaMatrix, by increasing column index
+  *
+  * This makes SellCSigmaMatrix usable with preconditioners such as DiagonalPreconditioner.
+  */
+template<typename Scalar, int ChunkSize, typename StorageIndex>
+class SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>::InnerIterator
+{
+  public:
+    InnerIterator(const SellCSigmaMatrix& mat, Index row)
+      : m_mat(mat), m_outer(row)
+    {
+      const Index p = mat.m_invPerm(row);
+      m_id = mat.m_chunkStart(p / ChunkSize) + p % ChunkSize;
+      m_end = m_id + Index(mat.m_rowLength(p)) * ChunkSize;
+    }
+
+    inline InnerIterator& operator++() { m_id += ChunkSize; return *this; }
+
+    inline const Scalar& value() const { return m_mat.m_values(m_id); }
+    inline StorageIndex index() const { return m_mat.m_indices(m_id); }
+    inline Index outer() const { return m_outer; }
+    inline Index row() const { return m_outer; }
+    inline Index col() const { return index(); }
+
+    inline operator bool() const { return m_id < m_end; }
+
+  protected:
+    const SellCSigmaMatrix& m_mat;
+    const Index m_outer;
+    Index m_id;
+    Index m_end;
+};
+
+namespace internal {
+
+template<typename Scalar, int ChunkSize, typename StorageIndex, typename Rhs, int ProductType>
+struct generic_product_impl<SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>, Rhs, SparseShape, DenseShape, ProductType>
+  : generic_product_impl_base<SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>, Rhs,
+                              generic_product_impl<SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex>, Rhs, SparseShape, DenseShape, ProductType> >
+{
+  typedef SellCSigmaMatrix<Scalar,ChunkSize,StorageIndex> Lhs;
+
+  template<typename Dest>
+  static void scaleAndAddTo(Dest& dst, const Lhs& lhs, const Rhs& rhs, const Scalar& alpha)
+  {
+    lhs.scaleAndAddTo(dst, rhs, alpha);
+  }
+};
+
+} // end namespace internal
+
+} // end namespace Eigen
+
+#endif // EIGEN_SELL_C_SIGMA_MATRIX_H
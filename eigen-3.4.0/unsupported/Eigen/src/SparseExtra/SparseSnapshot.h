@@ -0,0 +1,338 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef EIGEN_SPARSE_SNAPSHOT_H
+#define EIGEN_SPARSE_SNAPSHOT_H
+
+namespace Eigen {
+
+namespace internal {
+
+// A sparse snapshot is this header followed by the outer index, inner index and
+// value arrays of a compressed SparseMatrix, each one starting at an offset
+// aligned on sparse_snapshot_alignment bytes. All the fields are in the byte
+// order of the machine that wrote the file.
+struct sparse_snapshot_header
+{
+  char magic[8];                 // "EIGENCSR"
+  numext::uint32_t byte_order;   // sparse_snapshot_byte_order as written by the saving machine
+  numext::uint32_t version;
+  numext::uint32_t row_major;
+  numext::uint32_t scalar_size;
+  numext::uint32_t scalar_kind;  // 0: floating point, 1: complex, 2: integer
+  numext::uint32_t index_size;
+  numext::int64_t rows;
+  numext::int64_t cols;
+  numext::int64_t nnz;
+  numext::int64_t outer_offset;
+  numext::int64_t inner_offset;
+  numext::int64_t value_offset;
+  numext::int64_t file_size;
+};
+
+enum {
+  sparse_snapshot_version = 1,
+  sparse_snapshot_alignment = 64
+};
+
+static const numext::uint32_t sparse_snapshot_byte_order = 0x01020304u;
+
+inline numext::int64_t sparse_snapshot_align(numext::int64_t offset)
+{
+  return (offset + sparse_snapshot_alignment - 1) / sparse_snapshot_alignment * sparse_snapshot_alignment;
+}
+
+template<typename Scalar, typename StorageIndex>
+void sparse_snapshot_make_header(sparse_snapshot_header& header, bool rowMajor, Index rows, Index cols, Index nnz)
+{
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "EIGENCSR", 8);
+  header.byte_order = sparse_snapshot_byte_order;
+  header.version = sparse_snapshot_version;
+  header.row_major = rowMajor ? 1 : 0;
+  header.scalar_size = sizeof(Scalar);
+  header.scalar_kind = NumTraits<Scalar>::IsComplex ? 1 : NumTraits<Scalar>::IsInteger ? 2 : 0;
+  header.index_size = sizeof(StorageIndex);
+  header.rows = rows;
+  header.cols = cols;
+  header.nnz = nnz;
+  const Index outerSize = rowMajor ? rows : cols;
+  header.outer_offset = sparse_snapshot_align(sizeof(header));
+  header.inner_offset = sparse_snapshot_align(header.outer_offset + (outerSize + 1) * sizeof(StorageIndex));
+  header.value_offset = sparse_snapshot_align(header.inner_offset + nnz * sizeof(StorageIndex));
+  header.file_size = header.value_offset + nnz * sizeof(Scalar);
+}
+
+// Checks that a snapshot holds a matrix of the given scalar and index types and
+// that its arrays fit in a file of file_size bytes.
+template<typename Scalar, typename StorageIndex>
+bool sparse_snapshot_check_header(const sparse_snapshot_header& header, numext::int64_t file_size)
+{
+  sparse_snapshot_header ref;
+  sparse_snapshot_make_header<Scalar,StorageIndex>(ref, header.row_major != 0, header.rows, header.cols, header.nnz);
+  return std::memcmp(header.magic, ref.magic, 8) == 0
+      && header.byte_order == ref.byte_order
+      && header.version == ref.version
+      && header.scalar_size == ref.scalar_size
+      && header.scalar_kind == ref.scalar_kind
+      && header.index_size == ref.index_size
+      && header.rows >= 0 && header.cols >= 0 && header.nnz >= 0
+      && header.outer_offset == ref.outer_offset
+      && header.inner_offset == ref.inner_offset
+      && header.value_offset == ref.value_offset
+      && header.file_size == ref.file_size
+      && file_size >= header.file_size;
+}
+
+// Checks that the index arrays of a snapshot describe a valid compressed matrix:
+// the outer index starts at 0, never decreases and ends at nnz, and the inner
+// indices are in [0, inner_size).
+template<typename StorageIndex>
+bool sparse_snapshot_check_indices(const StorageIndex* outer, const StorageIndex* inner,
+                                   numext::int64_t outer_size, numext::int64_t inner_size, numext::int64_t nnz)
+{
+  if (outer[0] != 0 || static_cast<numext::int64_t>(outer[outer_size]) != nnz)
+    return false;
+  for (numext::int64_t j = 0; j < outer_size; ++j)
+    if (outer[j+1] < outer[j])
+      return false;
+  for (numext::int64_t k = 0; k < nnz; ++k)
+    if (inner[k] < 0 || static_cast<numext::int64_t>(inner[k]) >= inner_size)
+      return false;
+  return true;
+}
+
+inline void sparse_snapshot_pad(std::ofstream& out, numext::int64_t offset)
+{
+  static const char zeros[sparse_snapshot_alignment] = { 0 };
+  out.write(zeros, static_cast<std::streamsize>(offset - static_cast<numext::int64_t>(out.tellp())));
+}
+
+#if !defined(_WIN32)
+// Read-only memory mapping of a whole file.
+class sparse_mapped_file
+{
+  public:
+    sparse_mapped_file() : m_data(0), m_size(0) {}
+    ~sparse_mapped_file() { unmap(); }
+
+    bool map(const std::string& filename)
+    {
+      unmap();
+      const int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+        return false;
+      struct stat st;
+      bool ok = ::fstat(fd, &st) == 0;
+      if (ok && st.st_size > 0)
+      {
+        void* data = ::mmap(0, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = data != MAP_FAILED;
+        if (ok)
+        {
+          m_data = static_cast<const char*>(data);
+          m_size = static_cast<size_t>(st.st_size);
+        }
+      }
+      ::close(fd);
+      return ok;
+    }
+
+    void unmap()
+    {
+      if (m_data)
+        ::munmap(const_cast<char*>(m_data), m_size);
+      m_data = 0;
+      m_size = 0;
+    }
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    sparse_mapped_file(const sparse_mapped_file&);
+    sparse_mapped_file& operator=(const sparse_mapped_file&);
+
+    const char* m_data;
+    size_t m_size;
+};
+#endif
+
+} // end namespace internal
+
+/** \ingroup SparseExtra_Module
+  * \brief Saves \a mat in the binary sparse snapshot format.
+  *
+  * A snapshot stores the compressed arrays of \a mat as they are in memory, with a small header describing the sizes,
+  * the storage order and the scalar and index types. It is reloaded without any parsing by loadSparseSnapshot(), or
+  * even without any copy by SparseSnapshotMap. Snapshots are meant as a cache of already assembled matrices: the
+  * arrays are written in the byte order of the machine and are only read back on machines with the same byte order.
+  *
+  * \returns true on success
+  * \sa loadSparseSnapshot(), SparseSnapshotMap
+  */
+template<typename Scalar, int Options, typename StorageIndex>
+bool saveSparseSnapshot(const SparseMatrix<Scalar,Options,StorageIndex>& mat, const std::string& filename)
+{
+  if (!mat.isCompressed())
+  {
+    SparseMatrix<Scalar,Options,StorageIndex> compressed(mat);
+    compressed.makeCompressed();
+    return saveSparseSnapshot(compressed, filename);
+  }
+
+  std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!out)
+    return false;
+  internal::sparse_snapshot_header header;
+  internal::sparse_snapshot_make_header<Scalar,StorageIndex>(header, mat.IsRowMajor, mat.rows(), mat.cols(), mat.nonZeros());
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  internal::sparse_snapshot_pad(out, header.outer_offset);
+  out.write(reinterpret_cast<const char*>(mat.outerIndexPtr()), (mat.outerSize() + 1) * sizeof(StorageIndex));
+  internal::sparse_snapshot_pad(out, header.inner_offset);
+  out.write(reinterpret_cast<const char*>(mat.innerIndexPtr()), mat.nonZeros() * sizeof(StorageIndex));
+  internal::sparse_snapshot_pad(out, header.value_offset);
+  out.write(reinterpret_cast<const char*>(mat.valuePtr()), mat.nonZeros() * sizeof(Scalar));
+  out.close();
+  return !out.fail();
+}
+
+/** \ingroup SparseExtra_Module
+  * \brief Loads into \a mat a snapshot saved by saveSparseSnapshot().
+  *
+  * The arrays are read straight into the storage of \a mat. A snapshot saved with the other storage order is
+  * converted. The scalar and index types must be the same as the saved ones.
+  *
+  * \returns true on success, false if the file cannot be read or does not hold a matching and valid snapshot
+  * \sa saveSparseSnapshot(), SparseSnapshotMap
+  */
+template<typename Scalar, int Options, typename StorageIndex>
+bool loadSparseSnapshot(SparseMatrix<Scalar,Options,StorageIndex>& mat, const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!in)
+    return false;
+  in.seekg(0, std::ios::end);
+  const numext::int64_t file_size = static_cast<numext::int64_t>(in.tellg());
+  in.seekg(0, std::ios::beg);
+
+  internal::sparse_snapshot_header header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || !internal::sparse_snapshot_check_header<Scalar,StorageIndex>(header, file_size))
+    return false;
+
+  if ((header.row_major != 0) != bool(mat.IsRowMajor))
+  {
+    SparseMatrix<Scalar,Options^RowMajorBit,StorageIndex> other;
+    if (!loadSparseSnapshot(other, filename))
+      return false;
+    mat = other;
+    return true;
+  }
+
+  mat.resize(header.rows, header.cols);
+  mat.resizeNonZeros(header.nnz);
+  in.seekg(header.outer_offset);
+  in.read(reinterpret_cast<char*>(mat.outerIndexPtr()), (mat.outerSize() + 1) * sizeof(StorageIndex));
+  in.seekg(header.inner_offset);
+  in.read(reinterpret_cast<char*>(mat.innerIndexPtr()), header.nnz * sizeof(StorageIndex));
+  in.seekg(header.value_offset);
+  in.read(reinterpret_cast<char*>(mat.valuePtr()), header.nnz * sizeof(Scalar));
+  if (!in || !internal::sparse_snapshot_check_indices(mat.outerIndexPtr(), mat.innerIndexPtr(), mat.outerSize(),
+                                                      mat.innerSize(), header.nnz))
+  {
+    mat.resize(0, 0);
+    return false;
+  }
+  return true;
+}
+
+#if !defined(_WIN32)
+/** \ingroup SparseExtra_Module
+  * \class SparseSnapshotMap
+  * \brief Memory mapped, read-only view of a sparse snapshot
+  *
+  * The file saved by saveSparseSnapshot() is mapped in memory and exposed as a Map<const SparseMatrix>, so that
+  * opening it costs neither parsing nor copying: the pages are read by the operating system on first access and
+  * shared between the processes mapping the same file.
+  *
+  * \code
+  * SparseSnapshotMap<double> snapshot;
+  * if (snapshot.open("A.csr"))
+  *   y = snapshot.matrix() * x;
+  * \endcode
+  *
+  * The storage order, scalar and index types must be the same as the saved ones.
+  * The view is valid until the snapshot is closed or destroyed.
+  *
+  * \sa saveSparseSnapshot(), loadSparseSnapshot()
+  */
+template<typename _Scalar, int _Options = ColMajor, typename _StorageIndex = int>
+class SparseSnapshotMap
+{
+  public:
+    typedef _Scalar Scalar;
+    typedef _StorageIndex StorageIndex;
+    typedef SparseMatrix<Scalar,_Options,StorageIndex> SparseMatrixType;
+    typedef Map<const SparseMatrixType> MapType;
+
+    SparseSnapshotMap() {}
+
+    /** Maps the snapshot \a filename and checks its index arrays, which reads them once.
+      * \returns true on success, false if the file cannot be mapped or does not hold a matching and valid snapshot */
+    bool open(const std::string& filename)
+    {
+      if (!m_file.map(filename)
+          || m_file.size() < sizeof(internal::sparse_snapshot_header))
+      {
+        close();
+        return false;
+      }
+      std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+      if (!internal::sparse_snapshot_check_header<Scalar,StorageIndex>(m_header, static_cast<numext::int64_t>(m_file.size()))
+          || (m_header.row_major != 0) != bool(SparseMatrixType::IsRowMajor))
+      {
+        close();
+        return false;
+      }
+      const char* data = m_file.data();
+      const bool rowMajor = SparseMatrixType::IsRowMajor;
+      if (!internal::sparse_snapshot_check_indices(reinterpret_cast<const StorageIndex*>(data + m_header.outer_offset),
+                                                   reinterpret_cast<const StorageIndex*>(data + m_header.inner_offset),
+                                                   rowMajor ? m_header.rows : m_header.cols,
+                                                   rowMajor ? m_header.cols : m_header.rows, m_header.nnz))
+      {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    void close() { m_file.unmap(); }
+
+    bool isOpen() const { return m_file.data() != 0; }
+
+    /** \returns a view of the mapped matrix */
+    MapType matrix() const
+    {
+      eigen_assert(isOpen() && "SparseSnapshotMap is not open");
+      const char* data = m_file.data();
+      return MapType(m_header.rows, m_header.cols, m_header.nnz,
+                     reinterpret_cast<const StorageIndex*>(data + m_header.outer_offset),
+                     reinterpret_cast<const StorageIndex*>(data + m_header.inner_offset),
+                     reinterpret_cast<const Scalar*>(data + m_header.value_offset));
+    }
+
+  protected:
+    internal::sparse_mapped_file m_file;
+    internal::sparse_snapshot_header m_header;
+};
+#endif
+
+} // end namespace Eigen
+
+#endif // EIGEN_SPARSE_SNAPSHOT_H
@@ -177,7 +177,7 @@ void test_complex(int nfft)
   test_complex_generic<StdVectorContainer,T>(nfft);
   test_complex_generic<EigenVectorContainer,T>(nfft);
 }
-/*
+
 template <typename T,int nrows,int ncols>
 void test_complex2d()
 {
@@ -205,7 +205,6 @@ void test_complex2d()
     VERIFY( (src-src2).norm() < test_precision<T>() );
     VERIFY( (dst-dst2).norm() < test_precision<T>() );
 }
-*/
 
 
 void test_return_by_value(int len)
@@ -228,10 +227,11 @@ void test_return_by_value(int len)
 EIGEN_DECLARE_TEST(FFTW)
 {
   CALL_SUBTEST( test_return_by_value(32) );
-  //CALL_SUBTEST( ( test_complex2d<float,4,8> () ) ); CALL_SUBTEST( ( test_complex2d<double,4,8> () ) );
-  //CALL_SUBTEST( ( test_complex2d<long double,4,8> () ) );
+  CALL_SUBTEST( ( test_complex2d<float,4,8> () ) ); CALL_SUBTEST( ( test_complex2d<double,4,8> () ) );
+  CALL_SUBTEST( ( test_complex2d<float,12,15> () ) ); CALL_SUBTEST( ( test_complex2d<double,12,15> () ) );
   CALL_SUBTEST( test_complex<float>(32) ); CALL_SUBTEST( test_complex<double>(32) ); 
   CALL_SUBTEST( test_complex<float>(256) ); CALL_SUBTEST( test_complex<double>(256) ); 
+  CALL_SUBTEST( test_complex<float>(4*4*4*4*4*3) ); CALL_SUBTEST( test_complex<double>(4*4*4*4*4*3) ); 
   CALL_SUBTEST( test_complex<float>(3*8) ); CALL_SUBTEST( test_complex<double>(3*8) ); 
   CALL_SUBTEST( test_complex<float>(5*32) ); CALL_SUBTEST( test_complex<double>(5*32) ); 
   CALL_SUBTEST( test_complex<float>(2*3*4) ); CALL_SUBTEST( test_complex<double>(2*3*4) ); 
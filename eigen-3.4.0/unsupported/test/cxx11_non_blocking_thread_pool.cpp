@@ -169,6 +169,126 @@ static void test_pool_partitions() {
   phase = 2;
 }
 
+static void test_burst_submission(int num_threads) {
+  // Schedule many more tasks than the queues can hold while the workers are
+  // busy: none of them must run on the scheduling thread.
+  ThreadPool tp(num_threads);
+  std::atomic<bool> release(false);
+  std::atomic<int> blocked(0);
+  for (int i = 0; i < num_threads; ++i) {
+    tp.Schedule([&]() {
+      ++blocked;
+      while (!release) {
+      }
+    });
+  }
+  while (blocked != num_threads) {
+  }
+  const int kTasks = 20000;
+  std::atomic<int> ran(0);
+  std::atomic<int> ran_outside(0);
+  for (int i = 0; i < kTasks; ++i) {
+    tp.Schedule([&]() {
+      if (tp.CurrentThreadId() < 0) ++ran_outside;
+      ++ran;
+    });
+  }
+  VERIFY_IS_EQUAL(ran.load(), 0);
+  release = true;
+  while (ran != kTasks) {
+  }
+  VERIFY_IS_EQUAL(ran_outside.load(), 0);
+}
+
+static void test_priorities(int num_threads) {
+  // While the workers are busy, queue normal then high priority tasks: all
+  // the high priority ones must start before any normal priority one.
+  ThreadPool tp(num_threads);
+  std::atomic<bool> release(false);
+  std::atomic<int> blocked(0);
+  for (int i = 0; i < num_threads; ++i) {
+    tp.Schedule([&]() {
+      ++blocked;
+      while (!release) {
+      }
+    });
+  }
+  while (blocked != num_threads) {
+  }
+  const int kTasks = 100;
+  std::atomic<int> started(0);
+  std::atomic<int> high_started_late(0);
+  for (int i = 0; i < kTasks; ++i) {
+    tp.ScheduleWithPriority([&]() { ++started; }, ThreadPool::kNormalPriority);
+  }
+  for (int i = 0; i < kTasks; ++i) {
+    tp.ScheduleWithPriority(
+        [&]() {
+          // Normal priority tasks may only have started on the threads that
+          // were already running when this one was taken.
+          if (started++ >= kTasks + num_threads) ++high_started_late;
+        },
+        ThreadPool::kHighPriority);
+  }
+  release = true;
+  while (started != 2 * kTasks) {
+  }
+  VERIFY_IS_EQUAL(high_started_late.load(), 0);
+}
+
+static void test_reserved_threads() {
+  // The last thread only runs high priority tasks, which thus never wait
+  // behind the normal priority ones, even when these occupy all the others.
+  const int kThreads = 3;
+  const int kReserved = 1;
+  ThreadPool tp(kThreads, true, kReserved);
+  std::atomic<bool> release(false);
+  std::atomic<int> blocked(0);
+  std::atomic<int> normal_on_reserved(0);
+  for (int i = 0; i < kThreads - kReserved; ++i) {
+    tp.Schedule([&]() {
+      if (tp.CurrentThreadId() >= kThreads - kReserved) ++normal_on_reserved;
+      ++blocked;
+      while (!release) {
+      }
+    });
+  }
+  while (blocked != kThreads - kReserved) {
+  }
+
+  std::atomic<int> high_done(0);
+  for (int i = 0; i < 10; ++i) {
+    tp.ScheduleWithPriority(
+        [&]() {
+          VERIFY_IS_EQUAL(tp.CurrentThreadId(), kThreads - 1);
+          // Normal priority tasks scheduled by a reserved thread go to the
+          // other threads.
+          tp.Schedule([&]() {
+            if (tp.CurrentThreadId() >= kThreads - kReserved) ++normal_on_reserved;
+          });
+          ++high_done;
+        },
+        ThreadPool::kHighPriority);
+  }
+  while (high_done != 10) {
+  }
+  release = true;
+
+  // Normal priority tasks, even with a hint on the reserved thread, never run
+  // there.
+  Barrier barrier(200);
+  for (int i = 0; i < 200; ++i) {
+    tp.ScheduleWithHint(
+        [&]() {
+          if (tp.CurrentThreadId() >= kThreads - kReserved) ++normal_on_reserved;
+          barrier.Notify();
+        },
+        i % 2 == 0 ? kThreads - 1 : 0, kThreads);
+  }
+  barrier.Wait();
+  VERIFY_IS_EQUAL(normal_on_reserved.load(), 0);
+}
+
 
 EIGEN_DECLARE_TEST(cxx11_non_blocking_thread_pool)
 {
@@ -177,4 +297,9 @@ EIGEN_DECLARE_TEST(cxx11_non_blocking_thread_pool)
   CALL_SUBTEST(test_parallelism(false));
   CALL_SUBTEST(test_cancel());
   CALL_SUBTEST(test_pool_partitions());
+  CALL_SUBTEST(test_burst_submission(1));
+  CALL_SUBTEST(test_burst_submission(4));
+  CALL_SUBTEST(test_priorities(1));
+  CALL_SUBTEST(test_priorities(4));
+  CALL_SUBTEST(test_reserved_threads());
 }
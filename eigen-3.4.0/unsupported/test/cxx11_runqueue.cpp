@@ -227,9 +227,75 @@ void test_stress_runqueue()
   VERIFY(total.load() == 0);
 }
 
+void test_basic_overflow_queue()
+{
+  OverflowQueue<int, 4> q;
+  VERIFY(q.Empty());
+  VERIFY_IS_EQUAL(0u, q.Size());
+  VERIFY_IS_EQUAL(0, q.Pop());
+  // Grow past the first segment and drain in order.
+  for (int i = 1; i <= 10; i++) q.Push(i);
+  VERIFY(!q.Empty());
+  VERIFY_IS_EQUAL(10u, q.Size());
+  for (int i = 1; i <= 10; i++) VERIFY_IS_EQUAL(i, q.Pop());
+  VERIFY(q.Empty());
+  VERIFY_IS_EQUAL(0, q.Pop());
+  // Drained segments are reused.
+  for (int k = 0; k < 3; k++) {
+    for (int i = 1; i <= 12; i++) q.Push(i);
+    VERIFY_IS_EQUAL(12u, q.Size());
+    int sum = 0;
+    for (int v; (v = q.Pop()) != 0;) sum += v;
+    VERIFY_IS_EQUAL(78, sum);
+    VERIFY(q.Empty());
+  }
+  for (int i = 1; i <= 5; i++) q.Push(i);
+  q.Flush();
+  VERIFY(q.Empty());
+  VERIFY_IS_EQUAL(0, q.Pop());
+}
+
+void test_stress_overflow_queue()
+{
+  static const int kEvents = 1 << 16;
+  static const int kProducers = 3;
+  OverflowQueue<int, 8> q;
+  std::atomic<int> popped(0);
+  std::atomic<long> total(0);
+  std::vector<std::unique_ptr<std::thread>> threads;
+  for (int i = 0; i < kProducers; i++) {
+    threads.emplace_back(new std::thread([&q, &total]() {
+      long sum = 0;
+      for (int j = 1; j < kEvents; j++) {
+        q.Push(j);
+        sum += j;
+      }
+      total += sum;
+    }));
+    threads.emplace_back(new std::thread([&q, &total, &popped]() {
+      long sum = 0;
+      while (popped.load() < kProducers * (kEvents - 1)) {
+        int v = q.Pop();
+        if (v == 0) {
+          EIGEN_THREAD_YIELD();
+          continue;
+        }
+        sum += v;
+        popped++;
+      }
+      total -= sum;
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); i++) threads[i]->join();
+  VERIFY(q.Empty());
+  VERIFY(total.load() == 0);
+}
+
 EIGEN_DECLARE_TEST(cxx11_runqueue)
 {
   CALL_SUBTEST_1(test_basic_runqueue());
   CALL_SUBTEST_2(test_empty_runqueue());
   CALL_SUBTEST_3(test_stress_runqueue());
+  CALL_SUBTEST_4(test_basic_overflow_queue());
+  CALL_SUBTEST_5(test_stress_overflow_queue());
 }
@@ -0,0 +1,255 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#define EIGEN_USE_THREADS
+#include "sparse.h"
+#include <Eigen/SparseExtra>
+#include <clocale>
+
+template<typename SparseMatrixType>
+SparseMatrixType random_sparse(Index rows, Index cols, double density)
+{
+  typedef typename SparseMatrixType::Scalar Scalar;
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+  DenseMatrix ref(rows, cols);
+  SparseMatrixType m(rows, cols);
+  initSparse<Scalar>(density, ref, m);
+  return m;
+}
+
+template<typename Scalar, int LhsOptions>
+void test_parallel_sparse_dense_product(ThreadPool& pool)
+{
+  typedef SparseMatrix<Scalar,LhsOptions> SparseMatrixType;
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+  typedef Matrix<Scalar,Dynamic,1> DenseVector;
+
+  // The sizes cover products small enough to run on the calling thread, as well
+  // as products split in many tasks.
+  const Index sizes[] = { 1, 7, internal::random<Index>(50,100), internal::random<Index>(1000,2000) };
+  for (Index rows : sizes)
+  {
+    const Index cols = internal::random<Index>(1,2*rows);
+    const double density = (std::max)(8./(rows*cols), 0.05);
+    SparseMatrixType lhs = random_sparse<SparseMatrixType>(rows, cols, density);
+
+    DenseVector x = DenseVector::Random(cols);
+    DenseVector y;
+    parallelProduct(pool, lhs, x, y);
+    VERIFY_IS_APPROX(y, DenseVector(lhs*x));
+
+    DenseMatrix X = DenseMatrix::Random(cols, internal::random<Index>(1,8));
+    DenseMatrix Y;
+    parallelProduct(pool, lhs, X, Y);
+    VERIFY_IS_APPROX(Y, DenseMatrix(lhs*X));
+
+    // The right hand side may be an expression, and the destination a block.
+    DenseMatrix Z = DenseMatrix::Zero(rows, 2*X.cols());
+    typename DenseMatrix::ColsBlockXpr Zblock = Z.rightCols(X.cols());
+    parallelProduct(pool, lhs, 2*X, Zblock);
+    VERIFY_IS_APPROX(Z.rightCols(X.cols()), DenseMatrix(lhs*(2*X)));
+    VERIFY_IS_EQUAL(Z.leftCols(X.cols()), DenseMatrix::Zero(rows, X.cols()));
+  }
+
+  // Empty outer vectors.
+  SparseMatrixType empty(100, 200);
+  DenseVector y;
+  parallelProduct(pool, empty, DenseVector::Ones(200), y);
+  VERIFY_IS_EQUAL(y, DenseVector::Zero(100));
+}
+
+template<typename Scalar, int LhsOptions, int RhsOptions, int DstOptions>
+void test_parallel_sparse_sparse_product(ThreadPool& pool)
+{
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+
+  const Index sizes[] = { 1, 13, internal::random<Index>(50,100), internal::random<Index>(500,1000) };
+  for (Index size : sizes)
+  {
+    const Index rows = size;
+    const Index depth = internal::random<Index>(1,2*size);
+    const Index cols = internal::random<Index>(1,2*size);
+    SparseMatrix<Scalar,LhsOptions> lhs = random_sparse<SparseMatrix<Scalar,LhsOptions> >(rows, depth, (std::max)(4./(rows*depth), 0.02));
+    SparseMatrix<Scalar,RhsOptions> rhs = random_sparse<SparseMatrix<Scalar,RhsOptions> >(depth, cols, (std::max)(4./(depth*cols), 0.02));
+
+    SparseMatrix<Scalar,DstOptions> res;
+    parallelProduct(pool, lhs, rhs, res);
+    VERIFY(res.isCompressed());
+    VERIFY_IS_EQUAL(res.rows(), rows);
+    VERIFY_IS_EQUAL(res.cols(), cols);
+    VERIFY_IS_APPROX(DenseMatrix(res), DenseMatrix(lhs*rhs));
+
+    // Inner indices must be sorted.
+    for (Index j = 0; j < res.outerSize(); ++j)
+      for (Index p = res.outerIndexPtr()[j] + 1; p < res.outerIndexPtr()[j+1]; ++p)
+        VERIFY(res.innerIndexPtr()[p-1] < res.innerIndexPtr()[p]);
+
+    // Uncompressed operands.
+    lhs.reserve(VectorXi::Constant(lhs.outerSize(), 2));
+    parallelProduct(pool, lhs, rhs, res);
+    VERIFY_IS_APPROX(DenseMatrix(res), DenseMatrix(lhs*rhs));
+  }
+}
+
+template<typename Scalar, int Options>
+void test_parallel_set_from_triplets(ThreadPool& pool)
+{
+  typedef SparseMatrix<Scalar,Options> SparseMatrixType;
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+  typedef Triplet<Scalar> T;
+
+  // The sizes cover a single task as well as many tasks, with and without
+  // duplicates.
+  const Index sizes[] = { 0, 1, 100, internal::random<Index>(50000,200000) };
+  for (Index size : sizes)
+  {
+    const Index rows = internal::random<Index>(1,1000);
+    const Index cols = internal::random<Index>(1,1000);
+    std::vector<T> triplets(size);
+    for (Index k = 0; k < size; ++k)
+      triplets[k] = T(internal::random<Index>(0,rows-1), internal::random<Index>(0,cols-1), internal::random<Scalar>());
+
+    SparseMatrixType ref(rows, cols), res(rows, cols);
+    ref.setFromTriplets(triplets.begin(), triplets.end());
+    parallelSetFromTriplets(pool, triplets.begin(), triplets.end(), res);
+    VERIFY(res.isCompressed());
+    VERIFY_IS_EQUAL(res.nonZeros(), ref.nonZeros());
+    VERIFY_IS_EQUAL(res.rows(), rows);
+    VERIFY_IS_EQUAL(res.cols(), cols);
+    VERIFY_IS_APPROX(res, ref);
+    for (Index j = 0; j < res.outerSize(); ++j)
+      for (Index p = res.outerIndexPtr()[j] + 1; p < res.outerIndexPtr()[j+1]; ++p)
+        VERIFY(res.innerIndexPtr()[p-1] < res.innerIndexPtr()[p]);
+
+    // The duplicates are collapsed in the order of the triplet list.
+    auto keep_last = [](const Scalar&, const Scalar& b) { return b; };
+    ref.setFromTriplets(triplets.begin(), triplets.end(), keep_last);
+    parallelSetFromTriplets(pool, triplets.begin(), triplets.end(), res, keep_last);
+    VERIFY_IS_EQUAL(res.nonZeros(), ref.nonZeros());
+    VERIFY_IS_EQUAL(DenseMatrix(res), DenseMatrix(ref));
+  }
+}
+
+template<typename SparseMatrixType>
+void test_parallel_load_market(ThreadPool& pool)
+{
+  typedef typename SparseMatrixType::Scalar Scalar;
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+
+  // Large enough files are parsed by many tasks.
+  const Index sizes[] = { 1, 10, internal::random<Index>(200,400) };
+  for (Index size : sizes)
+  {
+    SparseMatrixType m1 = random_sparse<SparseMatrixType>(size, internal::random<Index>(1,2*size), 0.3), m2, m3;
+    saveMarket(m1, "cxx11_sparse_parallel.mtx");
+    VERIFY(loadMarket(m2, "cxx11_sparse_parallel.mtx"));
+    VERIFY(loadMarket(pool, m3, "cxx11_sparse_parallel.mtx"));
+    VERIFY_IS_EQUAL(m3.rows(), m1.rows());
+    VERIFY_IS_EQUAL(m3.cols(), m1.cols());
+    VERIFY_IS_EQUAL(DenseMatrix(m3), DenseMatrix(m2));
+  }
+  SparseMatrixType m;
+  VERIFY(!loadMarket(pool, m, "cxx11_sparse_parallel_missing.mtx"));
+}
+
+void test_parallel_load_market_format(ThreadPool& pool)
+{
+  std::ofstream out("cxx11_sparse_parallel.mtx");
+  out << "%%MatrixMarket matrix coordinate real general\n"
+      << "% a comment\n"
+      << "\n"
+      << "  3 4 7\r\n"
+      << "1 1 1.5\n"
+      << "\t2 3 -2.25e-3\r\n"
+      << "% another comment\n"
+      << "3 4 +12345678901234567890.5\n"
+      << "1 2 1e300\n"
+      << "2 2 0.1\n"
+      << "3 1 -0\n"
+      << "1 1 2";
+  out.close();
+
+  SparseMatrix<double> m;
+  VERIFY(loadMarket(pool, m, "cxx11_sparse_parallel.mtx"));
+  VERIFY_IS_EQUAL(m.rows(), 3);
+  VERIFY_IS_EQUAL(m.cols(), 4);
+  VERIFY_IS_EQUAL(m.coeff(0,0), 3.5);
+  VERIFY_IS_EQUAL(m.coeff(1,2), -2.25e-3);
+  VERIFY_IS_EQUAL(m.coeff(2,3), 12345678901234567890.5);
+  VERIFY_IS_EQUAL(m.coeff(0,1), 1e300);
+  VERIFY_IS_EQUAL(m.coeff(1,1), 0.1);
+  VERIFY_IS_EQUAL(m.nonZeros(), 6);
+
+  out.open("cxx11_sparse_parallel.mtx");
+  out << "%%MatrixMarket matrix coordinate pattern general\n"
+      << "2 2 2\n"
+      << "1 2\n"
+      << "2 1\n";
+  out.close();
+  VERIFY(loadMarket(pool, m, "cxx11_sparse_parallel.mtx"));
+  VERIFY_IS_EQUAL(m.nonZeros(), 2);
+  VERIFY_IS_EQUAL(m.coeff(0,1), 1.);
+  VERIFY_IS_EQUAL(m.coeff(1,0), 1.);
+}
+
+// saveMarket writes 17 significant digits, which are parsed by the slow path,
+// and the result must not depend on the decimal point of the C locale.
+void test_parallel_load_market_locale(ThreadPool& pool)
+{
+  const char* locales[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR.utf8", "fr_FR" };
+  const char* locale = 0;
+  for (const char* name : locales)
+  {
+    if (std::setlocale(LC_NUMERIC, name)) { locale = name; break; }
+  }
+  if (!locale)
+    std::cerr << "Warning: no locale with a decimal comma, parsing is only checked in the \"C\" locale" << std::endl;
+
+  SparseMatrix<double> m1 = random_sparse<SparseMatrix<double> >(internal::random<Index>(50,100), internal::random<Index>(50,100), 0.3), m2;
+  m1.coeffRef(0,0) = 1.2345678901234567;
+  saveMarket(m1, "cxx11_sparse_parallel.mtx");
+  VERIFY(loadMarket(pool, m2, "cxx11_sparse_parallel.mtx"));
+  VERIFY_IS_EQUAL(m2.nonZeros(), m1.nonZeros());
+  VERIFY_IS_EQUAL(MatrixXd(m2), MatrixXd(m1));
+
+  // A long number at the very end of the file, without a newline.
+  std::ofstream out("cxx11_sparse_parallel.mtx");
+  out << "%%MatrixMarket matrix coordinate real general\n"
+      << "2 2 2\n"
+      << "1 1 -0.33333333333333331\n"
+      << "2 2 1.2345678901234567e-5";
+  out.close();
+  VERIFY(loadMarket(pool, m2, "cxx11_sparse_parallel.mtx"));
+  VERIFY_IS_EQUAL(m2.coeff(0,0), -0.33333333333333331);
+  VERIFY_IS_EQUAL(m2.coeff(1,1), 1.2345678901234567e-5);
+
+  std::setlocale(LC_NUMERIC, "C");
+}
+
+EIGEN_DECLARE_TEST(cxx11_sparse_parallel)
+{
+  ThreadPool pool(internal::random<int>(1, 8));
+
+  CALL_SUBTEST_1(( test_parallel_sparse_dense_product<double, ColMajor>(pool) ));
+  CALL_SUBTEST_1(( test_parallel_sparse_dense_product<double, RowMajor>(pool) ));
+  CALL_SUBTEST_2(( test_parallel_sparse_dense_product<std::complex<float>, ColMajor>(pool) ));
+  CALL_SUBTEST_2(( test_parallel_sparse_dense_product<std::complex<float>, RowMajor>(pool) ));
+
+  CALL_SUBTEST_3(( test_parallel_sparse_sparse_product<double, ColMajor, ColMajor, ColMajor>(pool) ));
+  CALL_SUBTEST_3(( test_parallel_sparse_sparse_product<double, RowMajor, ColMajor, RowMajor>(pool) ));
+  CALL_SUBTEST_4(( test_parallel_sparse_sparse_product<float, ColMajor, RowMajor, ColMajor>(pool) ));
+  CALL_SUBTEST_4(( test_parallel_sparse_sparse_product<std::complex<double>, RowMajor, RowMajor, RowMajor>(pool) ));
+
+  CALL_SUBTEST_5(( test_parallel_set_from_triplets<double, ColMajor>(pool) ));
+  CALL_SUBTEST_5(( test_parallel_set_from_triplets<double, RowMajor>(pool) ));
+  CALL_SUBTEST_5(( test_parallel_set_from_triplets<std::complex<float>, ColMajor>(pool) ));
+
+  CALL_SUBTEST_6(( test_parallel_load_market<SparseMatrix<double> >(pool) ));
+  CALL_SUBTEST_6(( test_parallel_load_market<SparseMatrix<std::complex<float>,RowMajor> >(pool) ));
+  CALL_SUBTEST_6(( test_parallel_load_market_format(pool) ));
+  CALL_SUBTEST_6(( test_parallel_load_market_locale(pool) ));
+}
@@ -560,6 +560,61 @@ static void test_large_contraction_with_output_kernel() {
   }
 }
 
+// Contracts a batch of inputs with constant weights packed once.
+template <int DataLayout>
+static void test_packed_rhs() {
+  const Index depth = 70;
+  const Index width = 33;
+  Tensor<float, 2, DataLayout> weights(depth, width);
+  Tensor<float, 2, DataLayout> other_weights(depth, width);
+  weights.setRandom();
+  other_weights.setRandom();
+  Eigen::TensorContractionPackedRhs<float> packed;
+  VERIFY(packed.empty());
+
+  typedef Eigen::Matrix<float, Dynamic, Dynamic, DataLayout> MatrixXf;
+  typedef Map<MatrixXf> MapXf;
+  Eigen::array<DimPair, 1> dims = {{DimPair(1, 0)}};
+  const Index batches[] = {1, 7, 7, 300};
+  for (int i = 0; i < 6; ++i) {
+    // The panels are packed again for another tensor, and after clear().
+    Tensor<float, 2, DataLayout>& w = i == 4 ? other_weights : weights;
+    if (i == 5) {
+      weights.setRandom();
+      packed.clear();
+    }
+    const Index batch = batches[i % 4];
+    Tensor<float, 2, DataLayout> input(batch, depth);
+    input.setRandom();
+    Tensor<float, 2, DataLayout> result =
+        input.contract(w, dims, Eigen::NoOpOutputKernel(), &packed);
+    VERIFY_IS_EQUAL(packed.rows(), depth);
+    VERIFY_IS_EQUAL(packed.cols(), width);
+    MapXf m_input(input.data(), batch, depth);
+    MapXf m_weights(w.data(), depth, width);
+    MapXf m_result(result.data(), batch, width);
+    VERIFY_IS_APPROX(m_result, m_input * m_weights);
+  }
+
+  // The same tensor contracted along another dimension is packed again.
+  Tensor<float, 2, DataLayout> square(depth, depth);
+  square.setRandom();
+  Tensor<float, 2, DataLayout> input(5, depth);
+  input.setRandom();
+  MapXf m_input(input.data(), 5, depth);
+  MapXf m_square(square.data(), depth, depth);
+  Tensor<float, 2, DataLayout> result =
+      input.contract(square, dims, Eigen::NoOpOutputKernel(), &packed);
+  MapXf m_result(result.data(), 5, depth);
+  VERIFY_IS_APPROX(m_result, m_input * m_square);
+  Eigen::array<DimPair, 1> transposed_dims = {{DimPair(1, 1)}};
+  result = input.contract(square, transposed_dims, Eigen::NoOpOutputKernel(), &packed);
+  VERIFY_IS_APPROX(m_result, m_input * m_square.transpose());
+
+  packed.clear();
+  VERIFY(packed.empty());
+}
+
 EIGEN_DECLARE_TEST(cxx11_tensor_contraction)
 {
   CALL_SUBTEST_1(test_evals<ColMajor>());
@@ -594,6 +649,8 @@ EIGEN_DECLARE_TEST(cxx11_tensor_contraction)
   CALL_SUBTEST_8(test_const_inputs<RowMajor>());
   CALL_SUBTEST_8(test_large_contraction_with_output_kernel<ColMajor>());
   CALL_SUBTEST_8(test_large_contraction_with_output_kernel<RowMajor>());
+  CALL_SUBTEST_8(test_packed_rhs<ColMajor>());
+  CALL_SUBTEST_8(test_packed_rhs<RowMajor>());
 
   // Force CMake to split this test.
   // EIGEN_SUFFIXES;1;2;3;4;5;6;7;8
@@ -0,0 +1,192 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#define EIGEN_USE_THREADS
+#include <locale>
+#include "main.h"
+
+#include <cstdio>
+#include <Eigen/CXX11/Tensor>
+
+using Eigen::Tensor;
+using Eigen::TensorCostModelParameters;
+using Eigen::TensorOpCost;
+
+typedef Eigen::TensorCostModel<Eigen::ThreadPoolDevice> CostModel;
+
+static const char kProfile[] = "cxx11_tensor_cost_model_profile.txt";
+
+static void write_file(const char* path, const std::string& content) {
+  std::ofstream out(path);
+  out << content;
+}
+
+static bool same_parameters(const TensorCostModelParameters& a,
+                            const TensorCostModelParameters& b) {
+  return a.load_cycles == b.load_cycles && a.store_cycles == b.store_cycles &&
+         a.compute_cycles == b.compute_cycles &&
+         a.startup_cycles == b.startup_cycles &&
+         a.per_thread_cycles == b.per_thread_cycles &&
+         a.task_size == b.task_size;
+}
+
+// Must run before anything queries the cost model.
+static void test_profile_from_environment() {
+  static bool profile_written = false;
+  if (!profile_written) {
+    write_file(kProfile, "startup_cycles 5000\ntask_size 1234.5\n");
+#ifdef _WIN32
+    _putenv_s("EIGEN_TENSOR_COST_PROFILE", kProfile);
+#else
+    setenv("EIGEN_TENSOR_COST_PROFILE", kProfile, 1);
+#endif
+    profile_written = true;
+  }
+  const TensorCostModelParameters& params = TensorCostModelParameters::get();
+  VERIFY_IS_EQUAL(params.startup_cycles, 5000.0);
+  VERIFY_IS_EQUAL(params.task_size, 1234.5);
+  VERIFY_IS_EQUAL(params.per_thread_cycles,
+                  TensorCostModelParameters().per_thread_cycles);
+  std::remove(kProfile);
+}
+
+static void test_profile_round_trip() {
+  TensorCostModelParameters params;
+  params.load_cycles = 0.25;
+  params.store_cycles = 0.5;
+  params.startup_cycles = 12345.678;
+  params.per_thread_cycles = 20000;
+  params.task_size = 1.0 / 3;
+  VERIFY(params.save(kProfile));
+  TensorCostModelParameters loaded;
+  VERIFY(loaded.load(kProfile));
+  VERIFY(same_parameters(loaded, params));
+
+  // Comments, blank lines and unknown names are skipped, missing names keep
+  // their value.
+  write_file(kProfile, "# comment\n\nstore_cycles 2\nfrobnication 3\n");
+  VERIFY(loaded.load(kProfile));
+  VERIFY_IS_EQUAL(loaded.store_cycles, 2.0);
+  VERIFY_IS_EQUAL(loaded.load_cycles, 0.25);
+
+  // Invalid files leave the parameters unchanged.
+  const TensorCostModelParameters before = loaded;
+  write_file(kProfile, "task_size 0\n");
+  VERIFY(!loaded.load(kProfile));
+  write_file(kProfile, "load_cycles -1\n");
+  VERIFY(!loaded.load(kProfile));
+  write_file(kProfile, "store_cycles 0\n");
+  VERIFY(!loaded.load(kProfile));
+  write_file(kProfile, "startup_cycles\n");
+  VERIFY(!loaded.load(kProfile));
+  write_file(kProfile, "load_cycles 0,171875\n");
+  VERIFY(!loaded.load(kProfile));
+  write_file(kProfile, "startup_cycles 100 cycles\n");
+  VERIFY(!loaded.load(kProfile));
+  VERIFY(same_parameters(loaded, before));
+  std::remove(kProfile);
+  VERIFY(!loaded.load(kProfile));
+}
+
+// A decimal comma and a thousands separator.
+struct comma_numpunct : std::numpunct<char> {
+  char do_decimal_point() const { return ','; }
+  char do_thousands_sep() const { return '.'; }
+  std::string do_grouping() const { return "\3"; }
+};
+
+// Profiles are written and read in the classic locale, whatever the global
+// one.
+static void test_profile_locale() {
+  TensorCostModelParameters params;
+  params.load_cycles = 0.171875;
+  params.startup_cycles = 123456.5;
+  const std::locale previous =
+      std::locale::global(std::locale(std::locale::classic(), new comma_numpunct));
+  const bool saved = params.save(kProfile);
+  std::locale::global(previous);
+  VERIFY(saved);
+
+  std::ifstream in(kProfile);
+  std::stringstream content;
+  content << in.rdbuf();
+  VERIFY(content.str().find("load_cycles 0.171875\n") != std::string::npos);
+  VERIFY(content.str().find("startup_cycles 123456.5\n") != std::string::npos);
+
+  std::locale::global(std::locale(std::locale::classic(), new comma_numpunct));
+  TensorCostModelParameters loaded;
+  const bool ok = loaded.load(kProfile);
+  std::locale::global(previous);
+  VERIFY(ok);
+  VERIFY(same_parameters(loaded, params));
+  std::remove(kProfile);
+}
+
+static void test_set_parameters() {
+  const TensorCostModelParameters saved = TensorCostModelParameters::get();
+  const TensorOpCost cost(8, 4, 10);
+  const double size = 1e6;
+
+  TensorCostModelParameters params;
+  params.startup_cycles = 1e12;
+  TensorCostModelParameters::set(params);
+  VERIFY_IS_EQUAL(CostModel::numThreads(size, cost, 8), 1);
+
+  params.startup_cycles = 0;
+  params.per_thread_cycles = 1;
+  TensorCostModelParameters::set(params);
+  VERIFY_IS_EQUAL(CostModel::numThreads(size, cost, 8), 8);
+
+  // Twice the cost per cycle gives twice the cost.
+  params.load_cycles = params.store_cycles = 1;
+  TensorCostModelParameters::set(params);
+  const double total = CostModel::totalCost(size, cost);
+  VERIFY_IS_APPROX(total, size * (8 + 4 + 10));
+  params.load_cycles = params.store_cycles = params.compute_cycles = 2;
+  TensorCostModelParameters::set(params);
+  VERIFY_IS_APPROX(CostModel::totalCost(size, cost), 2 * total);
+  VERIFY_IS_APPROX(CostModel::taskSize(size, cost),
+                   2 * total / params.task_size);
+
+  TensorCostModelParameters::set(saved);
+}
+
+static void test_calibration() {
+  const TensorCostModelParameters saved = TensorCostModelParameters::get();
+  Eigen::ThreadPool pool(4);
+  Eigen::ThreadPoolDevice device(&pool, 4);
+  const TensorCostModelParameters params =
+      Eigen::calibrateTensorCostModel(device);
+  VERIFY(params.valid());
+  const TensorCostModelParameters defaults;
+  VERIFY_IS_EQUAL(params.compute_cycles, 1.0);
+  VERIFY(params.load_cycles >= defaults.load_cycles / 16 &&
+         params.load_cycles <= defaults.load_cycles * 16);
+  VERIFY(params.startup_cycles >= defaults.startup_cycles / 16 &&
+         params.startup_cycles <= defaults.startup_cycles * 16);
+  VERIFY(params.per_thread_cycles >= defaults.per_thread_cycles / 16 &&
+         params.per_thread_cycles <= defaults.per_thread_cycles * 16);
+
+  // Expressions evaluate the same with the calibrated model.
+  TensorCostModelParameters::set(params);
+  Tensor<float, 2> in(300, 200), out(300, 200);
+  in.setRandom();
+  out.device(device) = in * 2.0f + in.exp();
+  for (Index i = 0; i < in.size(); ++i) {
+    VERIFY_IS_APPROX(out.data()[i], in.data()[i] * 2.0f + std::exp(in.data()[i]));
+  }
+  TensorCostModelParameters::set(saved);
+}
+
+EIGEN_DECLARE_TEST(cxx11_tensor_cost_model)
+{
+  CALL_SUBTEST(test_profile_from_environment());
+  CALL_SUBTEST(test_profile_round_trip());
+  CALL_SUBTEST(test_profile_locale());
+  CALL_SUBTEST(test_set_parameters());
+  CALL_SUBTEST(test_calibration());
+}
@@ -252,6 +252,56 @@ static void test_fft_non_power_of_2_round_trip(int exponent) {
   }
 }
 
+template <int DataLayout, typename RealScalar, int FFTDirection>
+static void test_fft_real_input_matches_complex_input(int rows, int cols) {
+  Tensor<RealScalar, 2, DataLayout> input(rows, cols);
+  input.setRandom();
+  Tensor<std::complex<RealScalar>, 2, DataLayout> complex_input = input.template cast<std::complex<RealScalar> >();
+
+  array<int, 2> fft;
+  fft[0] = 0;
+  fft[1] = 1;
+
+  // Real inputs take the path that transforms two lines at once. Evaluate
+  // twice so that the second run uses the cached Bluestein plans.
+  for (int run = 0; run < 2; ++run) {
+    Tensor<std::complex<RealScalar>, 2, DataLayout> expected =
+        complex_input.template fft<BothParts, FFTDirection>(fft);
+    Tensor<std::complex<RealScalar>, 2, DataLayout> result =
+        input.template fft<BothParts, FFTDirection>(fft);
+    for (int i = 0; i < rows; ++i) {
+      for (int j = 0; j < cols; ++j) {
+        VERIFY_IS_APPROX(result(i, j), expected(i, j));
+      }
+    }
+  }
+}
+
+// The plan cache is bounded, and a plan that was evicted can be rebuilt.
+static void test_fft_plan_cache_is_bounded() {
+  typedef internal::TensorFFTPlanCache<std::complex<double> > PlanCache;
+  PlanCache::clear();
+  array<int, 1> fft;
+  fft[0] = 0;
+  for (int run = 0; run < 2; ++run) {
+    for (int len = 3; len < 3 + 2 * EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE; len += 2) {
+      Tensor<std::complex<double>, 1> input(len);
+      input.setRandom();
+      Tensor<std::complex<double>, 1> spectrum = input.template fft<BothParts, FFT_FORWARD>(fft);
+      // Naive DFT of the first coefficients.
+      for (int k = 0; k < 2; ++k) {
+        std::complex<double> expected(0, 0);
+        for (int n = 0; n < len; ++n) {
+          expected += input(n) * std::polar(1.0, -2 * double(EIGEN_PI) * k * n / len);
+        }
+        VERIFY_IS_APPROX(spectrum(k), expected);
+      }
+      VERIFY(PlanCache::size() <= EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE);
+    }
+  }
+  VERIFY_IS_EQUAL(PlanCache::size(), size_t(EIGEN_TENSOR_FFT_PLAN_CACHE_SIZE));
+}
+
 EIGEN_DECLARE_TEST(cxx11_tensor_fft) {
     test_fft_complex_input_golden();
     test_fft_real_input_golden();
@@ -301,4 +351,13 @@ EIGEN_DECLARE_TEST(cxx11_tensor_fft) {
 
     test_fft_non_power_of_2_round_trip<float>(7);
     test_fft_non_power_of_2_round_trip<double>(7);
+
+    test_fft_real_input_matches_complex_input<ColMajor, float, FFT_FORWARD>(16, 7);
+    test_fft_real_input_matches_complex_input<RowMajor, float, FFT_FORWARD>(16, 7);
+    test_fft_real_input_matches_complex_input<ColMajor, double, FFT_FORWARD>(33, 10);
+    test_fft_real_input_matches_complex_input<RowMajor, double, FFT_FORWARD>(33, 10);
+    test_fft_real_input_matches_complex_input<ColMajor, double, FFT_REVERSE>(21, 5);
+    test_fft_real_input_matches_complex_input<RowMajor, double, FFT_REVERSE>(21, 5);
+
+    test_fft_plan_cache_is_bounded();
 }
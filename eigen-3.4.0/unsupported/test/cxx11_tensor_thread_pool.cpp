@@ -670,6 +670,189 @@ void test_threadpool_allocate(TestAllocator* allocator)
   VERIFY_IS_EQUAL(allocator->dealloc_count(), num_allocs);
 }
 
+template<int DataLayout>
+void test_multithread_convolution()
+{
+  const int num_threads = internal::random<int>(3, 11);
+  ThreadPool tp(num_threads);
+  Eigen::ThreadPoolDevice thread_pool_device(&tp, num_threads);
+
+  // Long 1D signal smoothed by a short kernel.
+  {
+    const int size = internal::random<int>(1000, 100000);
+    Tensor<float, 1, DataLayout> signal(size);
+    Tensor<float, 1, DataLayout> kernel(7);
+    signal.setRandom();
+    kernel.setRandom();
+    Eigen::array<ptrdiff_t, 1> dims = {{0}};
+
+    Tensor<float, 1, DataLayout> expected = signal.convolve(kernel, dims);
+    Tensor<float, 1, DataLayout> result(size - 6);
+    result.device(thread_pool_device) = signal.convolve(kernel, dims);
+    for (int i = 0; i < size - 6; ++i) {
+      VERIFY_IS_APPROX(result(i), expected(i));
+    }
+  }
+
+  // 2D kernel over the two middle dimensions of a 4D tensor, with odd sizes
+  // that are not multiples of the packet size.
+  {
+    Tensor<float, 4, DataLayout> input(13, 37, 29, 5);
+    Tensor<float, 2, DataLayout> kernel(3, 4);
+    input.setRandom();
+    kernel.setRandom();
+    Eigen::array<ptrdiff_t, 2> dims = {{1, 2}};
+
+    Tensor<float, 4, DataLayout> expected = input.convolve(kernel, dims);
+    Tensor<float, 4, DataLayout> result(13, 35, 26, 5);
+    result.device(thread_pool_device) = input.convolve(kernel, dims);
+    for (int i = 0; i < 13; ++i) {
+      for (int j = 0; j < 35; ++j) {
+        for (int k = 0; k < 26; ++k) {
+          for (int l = 0; l < 5; ++l) {
+            VERIFY_IS_APPROX(result(i, j, k, l), expected(i, j, k, l));
+          }
+        }
+      }
+    }
+  }
+
+  // Convolution over the inner dimension nested in a larger expression, with
+  // an input expression and a kernel expression that must be evaluated first.
+  {
+    Tensor<double, 3, DataLayout> input(41, 11, 3);
+    Tensor<double, 3, DataLayout> kernel(2, 3, 2);
+    input.setRandom();
+    kernel.setRandom();
+    Eigen::array<ptrdiff_t, 3> dims = {{0, 1, 2}};
+
+    Tensor<double, 3, DataLayout> expected =
+        (input * 2.0).convolve(kernel + 1.0, dims) + 3.0;
+    Tensor<double, 3, DataLayout> result(40, 9, 2);
+    result.device(thread_pool_device) =
+        (input * 2.0).convolve(kernel + 1.0, dims) + 3.0;
+    for (int i = 0; i < 40; ++i) {
+      for (int j = 0; j < 9; ++j) {
+        for (int k = 0; k < 2; ++k) {
+          VERIFY_IS_APPROX(result(i, j, k), expected(i, j, k));
+        }
+      }
+    }
+  }
+}
+
+template<int DataLayout>
+void test_multithread_fft()
+{
+  const int num_threads = internal::random<int>(3, 11);
+  ThreadPool tp(num_threads);
+  Eigen::ThreadPoolDevice thread_pool_device(&tp, num_threads);
+
+  // Power of two rows and non power of two (Bluestein) columns.
+  Tensor<float, 3, DataLayout> input(64, 45, 7);
+  input.setRandom();
+  array<int, 2> fft;
+  fft[0] = 0;
+  fft[1] = 1;
+
+  Tensor<std::complex<float>, 3, DataLayout> expected = input.template fft<BothParts, FFT_FORWARD>(fft);
+  Tensor<std::complex<float>, 3, DataLayout> result(64, 45, 7);
+  result.device(thread_pool_device) = input.template fft<BothParts, FFT_FORWARD>(fft);
+  for (int i = 0; i < 64; ++i) {
+    for (int j = 0; j < 45; ++j) {
+      for (int k = 0; k < 7; ++k) {
+        VERIFY_IS_APPROX(result(i, j, k), expected(i, j, k));
+      }
+    }
+  }
+
+  Tensor<float, 3, DataLayout> round_trip(64, 45, 7);
+  round_trip.device(thread_pool_device) = result.template fft<RealPart, FFT_REVERSE>(fft);
+  for (int i = 0; i < 64; ++i) {
+    for (int j = 0; j < 45; ++j) {
+      for (int k = 0; k < 7; ++k) {
+        const float tol = test_precision<float>() *
+                          (std::abs(input(i, j, k)) + std::abs(round_trip(i, j, k)) + 1);
+        VERIFY_IS_APPROX_OR_LESS_THAN(std::abs(input(i, j, k) - round_trip(i, j, k)), tol);
+      }
+    }
+  }
+}
+
+template<int DataLayout>
+void test_topology_pool_contraction()
+{
+  // A pool pinned on the machine topology, with the large temporary buffers
+  // taken from fresh pages.
+  Tensor<float, 2, DataLayout> t_left(600, 300);
+  Tensor<float, 2, DataLayout> t_right(300, 700);
+  Tensor<float, 2, DataLayout> t_result(600, 700);
+  t_left.setRandom();
+  t_right.setRandom();
+
+  Eigen::TopologyThreadPool tp(4);
+  Eigen::FirstTouchAllocator allocator(/*min_mapped_bytes=*/1 << 12);
+  Eigen::ThreadPoolDevice device(&tp, 4, &allocator);
+
+  void* buffer = device.allocate(1 << 16);
+  VERIFY(buffer != NULL);
+  VERIFY_IS_EQUAL(reinterpret_cast<std::uintptr_t>(buffer) % EIGEN_MAX_ALIGN_BYTES, std::uintptr_t(0));
+  std::memset(buffer, 1, 1 << 16);
+  device.deallocate(buffer);
+
+  typedef Tensor<float, 1>::DimensionPair DimPair;
+  Eigen::array<DimPair, 1> dims = {{DimPair(1, 0)}};
+  t_result.device(device) = t_left.contract(t_right, dims);
+
+  typedef Map<Matrix<float, Dynamic, Dynamic, DataLayout>> MapXf;
+  MapXf m_left(t_left.data(), 600, 300);
+  MapXf m_right(t_right.data(), 300, 700);
+  Matrix<float, Dynamic, Dynamic, DataLayout> m_result = m_left * m_right;
+  for (Index i = 0; i < t_result.size(); i++) {
+    VERIFY_IS_APPROX(t_result.data()[i], m_result.data()[i]);
+  }
+}
+
+// Contracts batches of inputs with constant weights packed by the first
+// contraction.
+template<int DataLayout>
+void test_multithread_packed_rhs()
+{
+  const Index depth = 500;
+  const Index width = 300;
+  Tensor<float, 2, DataLayout> weights(depth, width);
+  Tensor<float, 2, DataLayout> other_weights(depth, width);
+  weights.setRandom();
+  other_weights.setRandom();
+  Eigen::TensorContractionPackedRhs<float> packed;
+
+  Eigen::ThreadPool tp(4);
+  Eigen::ThreadPoolDevice thread_pool_device(&tp, 4);
+
+  typedef Matrix<float, Dynamic, Dynamic, DataLayout> MatrixXf;
+  typedef Map<MatrixXf> MapXf;
+  typedef Tensor<float, 1>::DimensionPair DimPair;
+  Eigen::array<DimPair, 1> dims{{DimPair(1, 0)}};
+  const Index batches[] = {400, 400, 16, 1, 1000, 1000};
+  for (int i = 0; i < 6; ++i) {
+    // The last contraction uses another tensor, packed again.
+    Tensor<float, 2, DataLayout>& w = i == 5 ? other_weights : weights;
+    const Index batch = batches[i];
+    Tensor<float, 2, DataLayout> input(batch, depth);
+    input.setRandom();
+    Tensor<float, 2, DataLayout> result(batch, width);
+    result.device(thread_pool_device) =
+        input.contract(w, dims, Eigen::NoOpOutputKernel(), &packed);
+    VERIFY_IS_EQUAL(packed.rows(), depth);
+    VERIFY_IS_EQUAL(packed.cols(), width);
+
+    MapXf m_input(input.data(), batch, depth);
+    MapXf m_weights(w.data(), depth, width);
+    MapXf m_result(result.data(), batch, width);
+    VERIFY_IS_APPROX(m_result, m_input * m_weights);
+  }
+}
+
 EIGEN_DECLARE_TEST(cxx11_tensor_thread_pool)
 {
   CALL_SUBTEST_1(test_multithread_elementwise());
@@ -716,6 +899,18 @@ EIGEN_DECLARE_TEST(cxx11_tensor_thread_pool)
   CALL_SUBTEST_11(test_multithread_shuffle<RowMajor>(&test_allocator));
   CALL_SUBTEST_11(test_threadpool_allocate(&test_allocator));
 
+  CALL_SUBTEST_12(test_multithread_convolution<ColMajor>());
+  CALL_SUBTEST_12(test_multithread_convolution<RowMajor>());
+
+  CALL_SUBTEST_13(test_multithread_fft<ColMajor>());
+  CALL_SUBTEST_13(test_multithread_fft<RowMajor>());
+
+  CALL_SUBTEST_14(test_topology_pool_contraction<ColMajor>());
+  CALL_SUBTEST_14(test_topology_pool_contraction<RowMajor>());
+
+  CALL_SUBTEST_15(test_multithread_packed_rhs<ColMajor>());
+  CALL_SUBTEST_15(test_multithread_packed_rhs<RowMajor>());
+
   // Force CMake to split this test.
-  // EIGEN_SUFFIXES;1;2;3;4;5;6;7;8;9;10;11
+  // EIGEN_SUFFIXES;1;2;3;4;5;6;7;8;9;10;11;12;13;14;15
 }
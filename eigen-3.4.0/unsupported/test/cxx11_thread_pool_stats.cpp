@@ -0,0 +1,107 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#define EIGEN_USE_THREADS
+#include "main.h"
+#include "Eigen/CXX11/ThreadPool"
+
+typedef ThreadPoolTempl<StlThreadEnvironment, true> StatsThreadPool;
+
+static void test_stats_histogram() {
+  typedef ThreadPoolStats::Histogram Histogram;
+  VERIFY_IS_EQUAL(Histogram::Bucket(0), 0);
+  VERIFY_IS_EQUAL(Histogram::Bucket(1), 1);
+  VERIFY_IS_EQUAL(Histogram::Bucket(3), 2);
+  VERIFY_IS_EQUAL(Histogram::Bucket(4), 3);
+  VERIFY_IS_EQUAL(Histogram::Bucket(~uint64_t(0)), Histogram::kNumBuckets - 1);
+
+  Histogram h;
+  VERIFY_IS_EQUAL(h.Percentile(0.5), uint64_t(0));
+  for (int i = 0; i < 90; ++i) h.buckets[Histogram::Bucket(100)]++;
+  for (int i = 0; i < 10; ++i) h.buckets[Histogram::Bucket(5000)]++;
+  VERIFY_IS_EQUAL(h.Count(), uint64_t(100));
+  VERIFY_IS_EQUAL(h.Percentile(0.5), uint64_t(127));
+  VERIFY_IS_EQUAL(h.Percentile(0.9), uint64_t(127));
+  VERIFY_IS_EQUAL(h.Percentile(0.99), uint64_t(8191));
+}
+
+// Every task run from the queues was obtained by exactly one of these ways.
+static uint64_t dequeued_tasks(const ThreadPoolStats::Thread& t) {
+  return t.counters[ThreadPoolStats::kLocalPops] +
+         t.counters[ThreadPoolStats::kLocalSteals] +
+         t.counters[ThreadPoolStats::kGlobalSteals] +
+         t.counters[ThreadPoolStats::kWaitSteals] +
+         t.counters[ThreadPoolStats::kOverflowPops];
+}
+
+// The default pool does not collect anything.
+static void test_stats_disabled() {
+  ThreadPool tp(2);
+  tp.Schedule([]() {});
+  ThreadPoolStats stats = tp.Stats();
+  VERIFY(!stats.enabled);
+  VERIFY(stats.threads.empty());
+}
+
+static void test_stats(int num_threads) {
+  StatsThreadPool tp(num_threads);
+  ThreadPoolStats before = tp.Stats();
+  VERIFY(before.enabled);
+  VERIFY_IS_EQUAL(before.threads.size(), size_t(num_threads));
+
+  // A task scheduled from outside the pool schedules more tasks than its
+  // queue can hold, so that some of them go to the overflow queue.
+  const int kTasks = 3000;
+  std::atomic<int> ran(0);
+  tp.Schedule([&]() {
+    for (int i = 0; i < kTasks; ++i) {
+      tp.Schedule([&]() { ++ran; });
+    }
+    ++ran;
+  });
+  while (ran != kTasks + 1) {
+  }
+
+  // The counters of a task are updated after it returns.
+  ThreadPoolStats::Thread total;
+  do {
+    total = tp.Stats().Since(before).Total();
+  } while (total.counters[ThreadPoolStats::kTasksExecuted] !=
+           uint64_t(kTasks + 1));
+  VERIFY_IS_EQUAL(dequeued_tasks(total),
+                  total.counters[ThreadPoolStats::kTasksExecuted]);
+  VERIFY_IS_EQUAL(total.histograms[ThreadPoolStats::kTaskRunTime].Count(),
+                  total.counters[ThreadPoolStats::kTasksExecuted]);
+  VERIFY_IS_EQUAL(total.histograms[ThreadPoolStats::kQueueWaitTime].Count(),
+                  uint64_t(kTasks + 1));
+  VERIFY_GE(total.max_queue_size, 1u);
+  if (num_threads == 1) {
+    // Nobody steals from the only queue while the first task fills it.
+    VERIFY_GE(total.counters[ThreadPoolStats::kOverflowPushes],
+              uint64_t(kTasks - 1024));
+    VERIFY_IS_EQUAL(total.counters[ThreadPoolStats::kOverflowPops],
+                    total.counters[ThreadPoolStats::kOverflowPushes]);
+    VERIFY_GE(total.max_queue_size, 1000u);
+  }
+
+  // Idle workers eventually park.
+  while (tp.Stats().Since(before).Total().counters[ThreadPoolStats::kParks] <
+         uint64_t(num_threads)) {
+    std::this_thread::yield();
+  }
+  VERIFY_IS_EQUAL(tp.Stats().Total().queue_size, 0u);
+  VERIFY_IS_EQUAL(std::string(ThreadPoolStats::CounterName(ThreadPoolStats::kParks)),
+                  std::string("parks"));
+}
+
+EIGEN_DECLARE_TEST(cxx11_thread_pool_stats)
+{
+  CALL_SUBTEST(test_stats_histogram());
+  CALL_SUBTEST(test_stats_disabled());
+  CALL_SUBTEST(test_stats(1));
+  CALL_SUBTEST(test_stats(4));
+}
@@ -0,0 +1,219 @@
+// This file is part of Eigen, a lightweight C++ template library
+// for linear algebra.
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#define EIGEN_USE_THREADS
+#include "main.h"
+#include <Eigen/CXX11/ThreadPool>
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A fake sysfs tree, removed on destruction.
+class FakeSysfs {
+ public:
+  FakeSysfs() {
+    char name[] = "/tmp/eigen_sysfs_XXXXXX";
+    VERIFY(mkdtemp(name) != NULL);
+    root_ = name;
+    dirs_.push_back(root_);
+  }
+
+  ~FakeSysfs() {
+    for (size_t i = files_.size(); i > 0; --i) unlink(files_[i - 1].c_str());
+    for (size_t i = dirs_.size(); i > 0; --i) rmdir(dirs_[i - 1].c_str());
+  }
+
+  void Write(const std::string& path, const std::string& content) {
+    std::string dir = root_;
+    for (size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+      dir = root_ + "/" + path.substr(0, pos);
+      if (mkdir(dir.c_str(), 0700) == 0) dirs_.push_back(dir);
+    }
+    const std::string file = root_ + "/" + path;
+    std::ofstream out(file.c_str());
+    out << content << "\n";
+    files_.push_back(file);
+  }
+
+  const std::string& root() const { return root_; }
+
+ private:
+  std::string root_;
+  std::vector<std::string> dirs_;
+  std::vector<std::string> files_;
+};
+
+// Two sockets, one NUMA node each, two cores per socket and two hyperthreads
+// per core, numbered like Linux does: the siblings come after all the cores.
+static CpuTopology two_socket_topology(FakeSysfs& sysfs) {
+  sysfs.Write("devices/system/cpu/online", "0-7");
+  for (int cpu = 0; cpu < 8; ++cpu) {
+    const std::string dir = "devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+    sysfs.Write(dir + "core_id", std::to_string(cpu % 2));
+    sysfs.Write(dir + "physical_package_id", std::to_string((cpu / 2) % 2));
+  }
+  sysfs.Write("devices/system/node/node0/cpulist", "0-1,4-5");
+  sysfs.Write("devices/system/node/node1/cpulist", "2-3,6-7");
+  return CpuTopology::FromSysfs(sysfs.root());
+}
+#endif
+
+static void test_parse_cpu_list() {
+  std::vector<int> cpus;
+  VERIFY(CpuTopology::ParseCpuList("0-3,8,10-11", &cpus));
+  VERIFY_IS_EQUAL(cpus.size(), size_t(7));
+  VERIFY_IS_EQUAL(cpus[3], 3);
+  VERIFY_IS_EQUAL(cpus[4], 8);
+  VERIFY_IS_EQUAL(cpus[6], 11);
+  VERIFY(CpuTopology::ParseCpuList("5\n", &cpus));
+  VERIFY_IS_EQUAL(cpus.size(), size_t(1));
+  VERIFY(!CpuTopology::ParseCpuList("", &cpus));
+  VERIFY(!CpuTopology::ParseCpuList("3-1", &cpus));
+  VERIFY(!CpuTopology::ParseCpuList("1,x", &cpus));
+}
+
+static void test_detect() {
+  CpuTopology topology = CpuTopology::Detect();
+  VERIFY(!topology.cpus.empty());
+  VERIFY_GE(topology.NumNodes(), 1);
+
+  CpuTopology flat = CpuTopology::Flat(4);
+  VERIFY_IS_EQUAL(flat.NumNodes(), 1);
+  std::vector<std::pair<int, int>> ranges;
+  std::vector<int> placement = flat.Placement(6, &ranges);
+  VERIFY_IS_EQUAL(placement.size(), size_t(6));
+  VERIFY_IS_EQUAL(placement[4], 0);
+  VERIFY_IS_EQUAL(ranges.size(), size_t(1));
+  VERIFY_IS_EQUAL(ranges[0].second, 6);
+}
+
+static void test_sysfs_placement() {
+#if defined(__linux__)
+  FakeSysfs sysfs;
+  CpuTopology topology = two_socket_topology(sysfs);
+  VERIFY_IS_EQUAL(topology.cpus.size(), size_t(8));
+  VERIFY_IS_EQUAL(topology.NumNodes(), 2);
+  // Sorted by node, then core: the siblings are next to each other.
+  VERIFY_IS_EQUAL(topology.cpus[0].id, 0);
+  VERIFY_IS_EQUAL(topology.cpus[1].id, 4);
+  VERIFY_IS_EQUAL(topology.cpus[2].id, 1);
+  VERIFY_IS_EQUAL(topology.cpus[4].node, 1);
+  VERIFY_IS_EQUAL(topology.cpus[4].package, 1);
+
+  // One thread per core, half of them on each node.
+  std::vector<std::pair<int, int>> ranges;
+  std::vector<int> placement = topology.Placement(4, &ranges);
+  VERIFY_IS_EQUAL(placement.size(), size_t(4));
+  VERIFY_IS_EQUAL(topology.cpus[placement[0]].id, 0);
+  VERIFY_IS_EQUAL(topology.cpus[placement[1]].id, 1);
+  VERIFY_IS_EQUAL(topology.cpus[placement[2]].id, 2);
+  VERIFY_IS_EQUAL(topology.cpus[placement[3]].id, 3);
+  VERIFY_IS_EQUAL(ranges.size(), size_t(2));
+  VERIFY(ranges[0] == std::make_pair(0, 2));
+  VERIFY(ranges[1] == std::make_pair(2, 4));
+
+  // Then the hyperthreads, then wrap around.
+  placement = topology.Placement(10, &ranges);
+  VERIFY_IS_EQUAL(topology.cpus[placement[2]].id, 4);
+  VERIFY_IS_EQUAL(topology.cpus[placement[4]].id, 0);
+  VERIFY(ranges[1] == std::make_pair(5, 10));
+
+  // An odd number of threads.
+  placement = topology.Placement(3, &ranges);
+  VERIFY(ranges[0] == std::make_pair(0, 2));
+  VERIFY(ranges[1] == std::make_pair(2, 3));
+
+  TopologyThreadEnvironment env(4, TopologyThreadEnvironment::kNoPinning, topology);
+  std::vector<std::pair<unsigned, unsigned>> partitions = env.StealPartitions();
+  VERIFY_IS_EQUAL(partitions.size(), size_t(4));
+  VERIFY(partitions[1] == std::make_pair(0u, 2u));
+  VERIFY(partitions[2] == std::make_pair(2u, 4u));
+
+  // A pool on the fake topology: the CPUs may not exist, so do not pin.
+  TopologyThreadPool pool(4, true, env);
+  Barrier barrier(100);
+  std::atomic<int> bad_thread_id(0);
+  for (int i = 0; i < 100; ++i) {
+    pool.Schedule([&]() {
+      const int id = pool.CurrentThreadId();
+      if (id < 0 || id >= 4) ++bad_thread_id;
+      barrier.Notify();
+    });
+  }
+  barrier.Wait();
+  VERIFY_IS_EQUAL(bad_thread_id.load(), 0);
+#endif
+}
+
+// The online list does not have to be ascending.
+static void test_sysfs_unsorted() {
+#if defined(__linux__)
+  FakeSysfs sysfs;
+  sysfs.Write("devices/system/cpu/online", "5,1");
+  sysfs.Write("devices/system/node/node0/cpulist", "1");
+  sysfs.Write("devices/system/node/node1/cpulist", "5");
+  CpuTopology topology = CpuTopology::FromSysfs(sysfs.root());
+  VERIFY_IS_EQUAL(topology.cpus.size(), size_t(2));
+  VERIFY_IS_EQUAL(topology.cpus[0].id, 1);
+  VERIFY_IS_EQUAL(topology.cpus[0].node, 0);
+  VERIFY_IS_EQUAL(topology.cpus[1].id, 5);
+  VERIFY_IS_EQUAL(topology.cpus[1].node, 1);
+#endif
+}
+
+static void test_pinned_pool(TopologyThreadEnvironment::Pinning pinning) {
+  TopologyThreadPool pool(3, true, pinning);
+  VERIFY_IS_EQUAL(pool.NumThreads(), 3);
+  Barrier barrier(300);
+  std::atomic<int> sum(0);
+  for (int i = 0; i < 300; ++i) {
+    pool.Schedule([&, i]() {
+      sum += i;
+      barrier.Notify();
+    });
+  }
+  barrier.Wait();
+  VERIFY_IS_EQUAL(sum.load(), 299 * 300 / 2);
+}
+
+// An empty topology, as returned by a failed FromSysfs, places and pins
+// nothing, and the pool gets a single steal partition.
+static void test_empty_topology() {
+  const CpuTopology empty;
+  TopologyThreadEnvironment env(3, TopologyThreadEnvironment::kPinToCpu, empty);
+  VERIFY(env.Placement().empty());
+  const std::vector<std::pair<unsigned, unsigned>> partitions = env.StealPartitions();
+  VERIFY_IS_EQUAL(partitions.size(), size_t(3));
+  for (size_t i = 0; i < partitions.size(); ++i) {
+    VERIFY_IS_EQUAL(partitions[i].first, 0u);
+    VERIFY_IS_EQUAL(partitions[i].second, 3u);
+  }
+
+  TopologyThreadPool pool(3, true, env);
+  Barrier barrier(100);
+  std::atomic<int> sum(0);
+  for (int i = 0; i < 100; ++i) {
+    pool.Schedule([&, i]() {
+      sum += i;
+      barrier.Notify();
+    });
+  }
+  barrier.Wait();
+  VERIFY_IS_EQUAL(sum.load(), 99 * 100 / 2);
+}
+
+EIGEN_DECLARE_TEST(cxx11_thread_topology)
+{
+  CALL_SUBTEST(test_parse_cpu_list());
+  CALL_SUBTEST(test_detect());
+  CALL_SUBTEST(test_sysfs_placement());
+  CALL_SUBTEST(test_sysfs_unsorted());
+  CALL_SUBTEST(test_pinned_pool(TopologyThreadEnvironment::kPinToCpu));
+  CALL_SUBTEST(test_pinned_pool(TopologyThreadEnvironment::kPinToNode));
+  CALL_SUBTEST(test_empty_topology());
+}
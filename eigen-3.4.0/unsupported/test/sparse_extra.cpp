@@ -48,6 +48,7 @@ static long g_dense_op_sparse_count = 0;
 
 
 #include <Eigen/SparseExtra>
+#include <Eigen/IterativeLinearSolvers>
 
 template<typename SetterType,typename DenseType, typename Scalar, int Options>
 bool test_random_setter(SparseMatrix<Scalar,Options>& sm, const DenseType& ref, const std::vector<Vector2i>& nonzeroCoords)
@@ -187,6 +188,196 @@ void check_marketio_vector()
   VERIFY_IS_EQUAL(v1,v2);
 }
 
+template<typename SparseMatrixType>
+void check_sparse_snapshot()
+{
+  typedef typename SparseMatrixType::Scalar Scalar;
+  typedef typename SparseMatrixType::StorageIndex StorageIndex;
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+  enum { Options = SparseMatrixType::Options };
+  Index rows = internal::random<Index>(0,100);
+  Index cols = internal::random<Index>(0,100);
+  DenseMatrix refMat = DenseMatrix::Zero(rows, cols);
+  SparseMatrixType m1(rows, cols), m2;
+  if (rows > 0 && cols > 0)
+    initSparse<Scalar>(0.1, refMat, m1);
+  if (internal::random<bool>())
+    m1.reserve(VectorXi::Constant(m1.outerSize(), 2));
+
+  VERIFY(saveSparseSnapshot(m1, "sparse_extra.csr"));
+  VERIFY(loadSparseSnapshot(m2, "sparse_extra.csr"));
+  VERIFY(m2.isCompressed());
+  VERIFY_IS_EQUAL(m2.rows(), rows);
+  VERIFY_IS_EQUAL(m2.cols(), cols);
+  VERIFY_IS_EQUAL(DenseMatrix(m2), refMat);
+
+  SparseMatrix<Scalar,Options^RowMajorBit,StorageIndex> m3;
+  VERIFY(loadSparseSnapshot(m3, "sparse_extra.csr"));
+  VERIFY_IS_EQUAL(DenseMatrix(m3), refMat);
+
+#if !defined(_WIN32)
+  SparseSnapshotMap<Scalar,Options,StorageIndex> snapshot;
+  VERIFY(snapshot.open("sparse_extra.csr"));
+  VERIFY_IS_EQUAL(DenseMatrix(snapshot.matrix()), refMat);
+  SparseSnapshotMap<Scalar,Options^RowMajorBit,StorageIndex> wrong_order;
+  VERIFY(!wrong_order.open("sparse_extra.csr"));
+#endif
+
+  // Snapshots of other types, and other files, are rejected.
+  SparseMatrix<Scalar,Options,short> m4;
+  SparseMatrix<std::complex<Scalar>,Options,StorageIndex> m5;
+  VERIFY(!loadSparseSnapshot(m4, "sparse_extra.csr"));
+  VERIFY(!loadSparseSnapshot(m5, "sparse_extra.csr"));
+  saveMarket(m1, "sparse_extra.mtx");
+  VERIFY(!loadSparseSnapshot(m2, "sparse_extra.mtx"));
+  VERIFY(!loadSparseSnapshot(m2, "sparse_extra_missing.csr"));
+}
+
+// Overwrites the index at position i of the array starting at offset in a snapshot.
+void patch_snapshot_index(const char* filename, std::streamoff offset, Index i, int value)
+{
+  std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+  file.seekp(offset + std::streamoff(i * sizeof(int)));
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Snapshots whose index arrays are corrupt are rejected.
+void check_sparse_snapshot_corrupt()
+{
+  SparseMatrix<double> m(4, 3);
+  m.insert(0,0) = 1;
+  m.insert(2,0) = 2;
+  m.insert(1,1) = 3;
+  m.insert(3,2) = 4;
+  m.makeCompressed();
+  internal::sparse_snapshot_header header;
+  internal::sparse_snapshot_make_header<double,int>(header, false, 4, 3, 4);
+  const char* filename = "sparse_extra.csr";
+  // outer index: 0 2 3 4, inner index: 0 2 1 3
+  const int patches[][3] = {
+    { 0, 0, 1 },   // outer[0] != 0
+    { 0, 1, 4 },   // outer[1] > outer[2]
+    { 0, 3, 3 },   // outer[outerSize] != nnz
+    { 1, 1, 4 },   // inner index out of range
+    { 1, 2, -1 }   // negative inner index
+  };
+  for (int p = 0; p < 5; ++p)
+  {
+    VERIFY(saveSparseSnapshot(m, filename));
+    patch_snapshot_index(filename, patches[p][0] == 0 ? header.outer_offset : header.inner_offset,
+                         patches[p][1], patches[p][2]);
+    SparseMatrix<double> loaded;
+    VERIFY(!loadSparseSnapshot(loaded, filename));
+    SparseMatrix<double,RowMajor> converted;
+    VERIFY(!loadSparseSnapshot(converted, filename));
+#if !defined(_WIN32)
+    SparseSnapshotMap<double> snapshot;
+    VERIFY(!snapshot.open(filename));
+    VERIFY(!snapshot.isOpen());
+#endif
+  }
+}
+
+template<typename Scalar, int ChunkSize>
+void check_sell_c_sigma()
+{
+  typedef Matrix<Scalar,Dynamic,Dynamic> DenseMatrix;
+  typedef Matrix<Scalar,Dynamic,1> DenseVector;
+  typedef SellCSigmaMatrix<Scalar,ChunkSize> SellMatrix;
+
+  Index rows = internal::random<Index>(1,200);
+  Index cols = internal::random<Index>(1,200);
+  DenseMatrix refMat = DenseMatrix::Zero(rows, cols);
+  SparseMatrix<Scalar> m(rows, cols);
+  initSparse<Scalar>(internal::random<double>(0.01,0.3), refMat, m);
+  // a few long rows to get ragged chunks
+  for (Index k = 0; k < 3; ++k)
+  {
+    Index i = internal::random<Index>(0,rows-1);
+    for (Index j = 0; j < cols; j += 2)
+      m.coeffRef(i,j) = refMat(i,j) = internal::random<Scalar>();
+  }
+
+  const Index sigmas[] = { 1, ChunkSize, internal::random<Index>(1,rows), rows };
+  for (int s = 0; s < 4; ++s)
+  {
+    const Index sigma = sigmas[s];
+    SellMatrix sell(m, sigma);
+    VERIFY_IS_EQUAL(sell.rows(), rows);
+    VERIFY_IS_EQUAL(sell.cols(), cols);
+    VERIFY_IS_EQUAL(sell.nonZeros(), m.nonZeros());
+    VERIFY(sell.storedCoefficients() >= m.nonZeros());
+
+    DenseVector x = DenseVector::Random(cols);
+    DenseVector y = sell * x;
+    VERIFY_IS_APPROX(y, refMat * x);
+
+    DenseMatrix X = DenseMatrix::Random(cols, internal::random<Index>(1,5));
+    DenseMatrix Y = DenseMatrix::Random(rows, X.cols());
+    DenseMatrix refY = Y;
+    Y -= sell * X;
+    refY -= refMat * X;
+    VERIFY_IS_APPROX(Y, refY);
+    VERIFY_IS_APPROX(DenseMatrix(sell * X.leftCols(1)), refMat * X.leftCols(1));
+
+    // Row iterators visit the original rows by increasing column index.
+    for (Index i = 0; i < rows; ++i)
+    {
+      DenseVector row = DenseVector::Zero(cols);
+      Index prev = -1;
+      for (typename SellMatrix::InnerIterator it(sell, i); it; ++it)
+      {
+        VERIFY(it.index() > prev);
+        prev = it.index();
+        row(it.index()) = it.value();
+      }
+      VERIFY_IS_EQUAL(row, DenseVector(refMat.row(i).transpose()));
+    }
+  }
+
+  // As a matrix-free operator of the iterative solvers.
+  Index n = internal::random<Index>(10,200);
+  SparseMatrix<Scalar> b_mat(n, n);
+  DenseMatrix refB = DenseMatrix::Zero(n, n);
+  initSparse<Scalar>(0.05, refB, b_mat);
+  SparseMatrix<Scalar> spd = SparseMatrix<Scalar>(b_mat.adjoint() * b_mat);
+  for (Index i = 0; i < n; ++i)
+    spd.coeffRef(i,i) += Scalar(n);
+  SellMatrix sell(spd);
+  DenseVector rhs = DenseVector::Random(n);
+
+  ConjugateGradient<SellMatrix, Lower|Upper> cg(sell);
+  DenseVector sol = cg.solve(rhs);
+  VERIFY_IS_EQUAL(cg.info(), Success);
+  VERIFY_IS_APPROX(DenseVector(spd * sol), rhs);
+
+  BiCGSTAB<SellMatrix> bicg(sell);
+  sol = bicg.solve(rhs);
+  VERIFY_IS_EQUAL(bicg.info(), Success);
+  VERIFY_IS_APPROX(DenseVector(spd * sol), rhs);
+}
+
+// The padding can exceed the range of the storage index even when the non
+// zeros fit: one full row per chunk, and no sorting to group them.
+void check_sell_c_sigma_padding()
+{
+  typedef SellCSigmaMatrix<double,8,short> SellMatrix;
+  const Index chunks = 20, rows = 8 * chunks, cols = 300;
+  SparseMatrix<double,RowMajor,short> m(rows, cols);
+  std::vector<Triplet<double,short> > triplets;
+  for (Index c = 0; c < chunks; ++c)
+    for (Index j = 0; j < cols; ++j)
+      triplets.push_back(Triplet<double,short>(short(8 * c + c % 8), short(j), internal::random<double>()));
+  m.setFromTriplets(triplets.begin(), triplets.end());
+
+  SellMatrix sell(m, 1);
+  VERIFY_IS_EQUAL(sell.nonZeros(), chunks * cols);
+  VERIFY_IS_EQUAL(sell.storedCoefficients(), rows * cols);
+  VERIFY(sell.storedCoefficients() > NumTraits<short>::highest());
+  VectorXd x = VectorXd::Random(cols);
+  VERIFY_IS_APPROX(VectorXd(sell * x), VectorXd(m * x));
+}
+
 EIGEN_DECLARE_TEST(sparse_extra)
 {
   for(int i = 0; i < g_repeat; i++) {
@@ -221,6 +412,18 @@ EIGEN_DECLARE_TEST(sparse_extra)
     CALL_SUBTEST_5( (check_marketio_vector<Matrix<std::complex<float>,Dynamic,1> >()) );
     CALL_SUBTEST_5( (check_marketio_vector<Matrix<std::complex<double>,Dynamic,1> >()) );
 
+    CALL_SUBTEST_6( (check_sell_c_sigma<double, SellCSigmaMatrix<double>::ChunkSize>()) );
+    CALL_SUBTEST_6( (check_sell_c_sigma<float, SellCSigmaMatrix<float>::ChunkSize>()) );
+    CALL_SUBTEST_6( (check_sell_c_sigma<std::complex<double>, SellCSigmaMatrix<std::complex<double> >::ChunkSize>()) );
+    CALL_SUBTEST_6( (check_sell_c_sigma<double, 1>()) );
+    CALL_SUBTEST_6( (check_sell_c_sigma<float, 3>()) );
+    CALL_SUBTEST_6( check_sell_c_sigma_padding() );
+
+    CALL_SUBTEST_7( (check_sparse_snapshot<SparseMatrix<double,ColMajor,int> >()) );
+    CALL_SUBTEST_7( (check_sparse_snapshot<SparseMatrix<float,RowMajor,int> >()) );
+    CALL_SUBTEST_7( (check_sparse_snapshot<SparseMatrix<std::complex<double>,ColMajor,long int> >()) );
+    CALL_SUBTEST_7( check_sparse_snapshot_corrupt() );
+
     TEST_SET_BUT_UNUSED_VARIABLE(s);
   }
 }